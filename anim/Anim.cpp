@@ -1,6 +1,6 @@
 #include "Anim.h"
 
-// Shaderpaths: ("../res/shaders/instance.vert", "../res/shaders/instance.frag")
+// Shaderpaths: ("../res/shaders/instance.vert", "../res/shaders/lit.frag")
 
 Anim::Anim()
 {
@@ -0,0 +1,7 @@
+// Per-frame camera data, shared by every program (FrameUniforms in SceneUniforms.h)
+layout (std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPosition;
+};
@@ -1,17 +1,14 @@
-#version 330 core
-
-struct Material 
-{
-    sampler2D diffuse;
-    sampler2D specular;
-    float shininess;
-}; 
+// Scene lights, shared by every lit program (LightUniforms in SceneUniforms.h). The array sizes
+// NR_POINT_LIGHTS and NR_SPOT_LIGHTS are injected by the application, so they always match the buffer.
+#if !defined(NR_POINT_LIGHTS) || !defined(NR_SPOT_LIGHTS)
+#error NR_POINT_LIGHTS and NR_SPOT_LIGHTS must be defined
+#endif
 
+// std140 layouts: each vec3 is followed by a scalar that fills its 16 bytes
 struct DirLight 
 {
+    vec3 direction;
     bool enabled;
-
-    vec3 direction;	
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
@@ -19,78 +16,50 @@ struct DirLight
 
 struct PointLight 
 {
+    vec3 position;
     bool enabled;
-    
-    float constant;
-    float linear;
-    float quadratic;
-	
-	vec3 position;
     vec3 ambient;
+    float constant;
     vec3 diffuse;
+    float linear;
     vec3 specular;
+    float quadratic;
 };
 
 struct SpotLight 
 {
-    bool enabled;
-
     vec3 position;
+    bool enabled;
     vec3 direction;
-	
     float cutOff;
+    vec3 ambient;
     float outerCutOff;
+    vec3 diffuse;
     float constant;
+    vec3 specular;
     float linear;
     float quadratic;
-  
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;       
 };
 
-#define NR_SPOT_LIGHTS 2
-
-in vec3 FragPos;
-in vec3 Normal;
-in vec2 TexCoords;
-
-uniform vec3 viewPos;
-uniform DirLight dirLight;
-uniform PointLight pointLight;
-uniform SpotLight spotLights[2];
-uniform Material material;
-
-out vec4 FragColor;
-
-// == Function prototypes ==
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-
+layout (std140) uniform LightData
+{
+    DirLight dirLight;
+    PointLight pointLights[NR_POINT_LIGHTS];
+    SpotLight spotLights[NR_SPOT_LIGHTS];
+    int pointLightCount;
+    int spotLightCount;
+};
 
-void main()
-{    
-    vec3 norm = normalize(Normal);
-    vec3 viewDir = normalize(viewPos - FragPos);
-    
-    //Phase 1: directional lighting
-    vec3 result = CalcDirLight(dirLight, norm, viewDir);
-	
-    //Phase 2: point lights
-    result += CalcPointLight(pointLight, norm, FragPos, viewDir);
-	
-    //Phase 3: spot light
-    for(int i = 0; i < NR_SPOT_LIGHTS; i++)
-	{
-        result += CalcSpotLight(spotLights[i], norm, FragPos, viewDir);
-	}
-	
-    FragColor = vec4(result, 1.0);
-}
+// Surface inputs of the lighting functions, sampled once per fragment
+struct Surface
+{
+    vec3 albedo;
+    vec3 specular;
+    float shininess;
+};
 
 
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
+vec3 CalcDirLight(DirLight light, Surface surface, vec3 normal, vec3 viewDir)
 {
     if(!light.enabled) return vec3(0.0f);
     vec3 lightDir = normalize(-light.direction);
@@ -98,16 +67,16 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
     float diff = max(dot(normal, lightDir), 0.0);
     //Specular shading
     vec3 reflectDir = normalize(lightDir + viewDir);  
-    float spec = pow(max(dot(normal, reflectDir), 0.0), material.shininess);
+    float spec = pow(max(dot(normal, reflectDir), 0.0), surface.shininess);
     //Combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+    vec3 ambient = light.ambient * surface.albedo;
+    vec3 diffuse = light.diffuse * diff * surface.albedo;
+    vec3 specular = light.specular * spec * surface.specular;
     return (ambient + diffuse + specular);
 }
 
 
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 CalcPointLight(PointLight light, Surface surface, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
     if(!light.enabled) return vec3(0.0f);
     vec3 lightDir = normalize(light.position - fragPos);
@@ -115,14 +84,14 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float diff = max(dot(normal, lightDir), 0.0);
     //Specular shading
     vec3 reflectDir = normalize(lightDir + viewDir);  
-    float spec = pow(max(dot(normal, reflectDir), 0.0), material.shininess);
+    float spec = pow(max(dot(normal, reflectDir), 0.0), surface.shininess);
     //Attenuation
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
     //Combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+    vec3 ambient = light.ambient * surface.albedo;
+    vec3 diffuse = light.diffuse * diff * surface.albedo;
+    vec3 specular = light.specular * spec * surface.specular;
     ambient *= attenuation;
     diffuse *= attenuation;
     specular *= attenuation;
@@ -130,7 +99,7 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 }
 
 
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 CalcSpotLight(SpotLight light, Surface surface, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
     if(!light.enabled) return vec3(0.0f);
     vec3 lightDir = normalize(light.position - fragPos);
@@ -138,7 +107,7 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float diff = max(dot(normal, lightDir), 0.0);
     //Specular shading
     vec3 reflectDir = normalize(lightDir + viewDir);  
-    float spec = pow(max(dot(normal, reflectDir), 0.0), material.shininess);
+    float spec = pow(max(dot(normal, reflectDir), 0.0), surface.shininess);
     //Attenuation
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
@@ -147,11 +116,32 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float epsilon = light.cutOff - light.outerCutOff;
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
     //Combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+    vec3 ambient = light.ambient * surface.albedo;
+    vec3 diffuse = light.diffuse * diff * surface.albedo;
+    vec3 specular = light.specular * spec * surface.specular;
     ambient *= attenuation * intensity;
     diffuse *= attenuation * intensity;
     specular *= attenuation * intensity;
     return (ambient + diffuse + specular);
 }
+
+
+// Directional, point and spot lights together
+vec3 CalcLighting(Surface surface, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    //Phase 1: directional lighting
+    vec3 result = CalcDirLight(dirLight, surface, normal, viewDir);
+	
+    //Phase 2: point lights
+    for(int i = 0; i < pointLightCount; i++)
+    {
+        result += CalcPointLight(pointLights[i], surface, normal, fragPos, viewDir);
+    }
+	
+    //Phase 3: spot lights
+    for(int i = 0; i < spotLightCount; i++)
+	{
+        result += CalcSpotLight(spotLights[i], surface, normal, fragPos, viewDir);
+	}
+    return result;
+}
@@ -5,8 +5,12 @@ layout (location = 2) in vec2 aTexCoords;
 layout (location = 3) in mat4 aInstanceMatrix;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+#include "include/frame.glsl"
+
+// Dequantization of compact mesh positions; scale 1 and offset 0 for float vertices
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
 
 out vec3 FragPos;
 out vec3 Normal;
@@ -14,10 +18,11 @@ out vec2 TexCoords;
 
 void main()
 {
-    FragPos = vec3(aInstanceMatrix * vec4(aPos, 1.0));
+    vec3 position = aPos * positionScale + positionOffset;
+    FragPos = vec3(aInstanceMatrix * vec4(position, 1.0));
     Normal = mat3(transpose(inverse(aInstanceMatrix))) * aNormal;  
     TexCoords = aTexCoords;
     
-    gl_Position = projection * view * aInstanceMatrix * vec4(aPos, 1.0);
+    gl_Position = projection * view * aInstanceMatrix * vec4(position, 1.0);
 }
 
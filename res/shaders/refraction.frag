@@ -3,14 +3,15 @@
 in vec3 Normal;
 in vec3 Position;
 
-uniform vec3 cameraPos;
+#include "include/frame.glsl"
+
 uniform samplerCube skybox;
 
 out vec4 FragColor;
 
 void main()
 {
-    vec3 I = normalize(Position - cameraPos);
+    vec3 I = normalize(Position - cameraPosition);
     vec3 n = normalize(Normal);
     vec3 ratio = vec3(1.00 / 1.52, 1.00 / 1.55, 1.00 / 1.58);
 
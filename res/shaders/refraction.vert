@@ -4,16 +4,21 @@ layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+#include "include/frame.glsl"
+
+// Dequantization of compact mesh positions; scale 1 and offset 0 for float vertices
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
 
 out vec3 Normal;
 out vec3 Position;
 
 void main()
 {
+    vec3 position = aPos * positionScale + positionOffset;
     Normal = mat3(transpose(inverse(model))) * aNormal;
-    Position = vec3(model * vec4(aPos, 1.0));
+    Position = vec3(model * vec4(position, 1.0));
 
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * model * vec4(position, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+// 64-bit FNV-1a. Used to key cached assets on their content, not to protect against tampering.
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = FNV_OFFSET_BASIS)
+{
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+inline uint64_t hashString(std::string_view text, uint64_t seed = FNV_OFFSET_BASIS)
+{
+    return hashBytes(text.data(), text.size(), seed);
+}
+
+inline bool hashFile(const std::string& path, uint64_t& hash)
+{
+    const MappedFile source(path);
+    if (!source.isOpen()) return false;
+    hash = hashBytes(source.data(), source.size());
+    return true;
+}
+
+inline int64_t fileModificationTime(const std::string& path)
+{
+    std::error_code ec;
+    const auto time = std::filesystem::last_write_time(path, ec);
+    return ec ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+// Identifies the version of a source file that cooked data was built from
+struct SourceStamp
+{
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint64_t hash = 0;
+
+    static bool capture(const std::string& path, SourceStamp& stamp)
+    {
+        std::error_code ec;
+        stamp.size = std::filesystem::file_size(path, ec);
+        if (ec) return false;
+        stamp.mtime = fileModificationTime(path);
+        return hashFile(path, stamp.hash);
+    }
+
+    // Size and mtime are checked first; the file is only hashed when its mtime moved.
+    // touched reports a new mtime over unchanged content, so the caller can store the new one.
+    bool matches(const std::string& path, bool& touched) const
+    {
+        touched = false;
+        std::error_code ec;
+        if (std::filesystem::file_size(path, ec) != size || ec) return false;
+        const int64_t currentMtime = fileModificationTime(path);
+        if (currentMtime == mtime) return true;
+
+        uint64_t currentHash = 0;
+        if (!hashFile(path, currentHash) || currentHash != hash) return false;
+        touched = true;
+        return true;
+    }
+};
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Hot reload: watches an asset tree with inotify and runs the callbacks subscribed to a file
+// once it has been written. Events are collected on a background thread; callbacks run from
+// update() on the GL thread, at a frame boundary, so they may swap GL objects directly.
+// A file must stay quiet for SETTLE_TIME before it fires, which folds the several writes an
+// editor's save produces into one reload. Outside Linux start() fails and nothing ever fires.
+class AssetWatcher
+{
+public:
+    using Callback = std::function<void()>;
+
+    static constexpr std::chrono::milliseconds SETTLE_TIME{ 150 };
+
+    static AssetWatcher& instance()
+    {
+        static AssetWatcher watcher;
+        return watcher;
+    }
+
+    ~AssetWatcher()
+    {
+        stop();
+    }
+
+    AssetWatcher(const AssetWatcher&) = delete;
+    AssetWatcher& operator=(const AssetWatcher&) = delete;
+
+    // Watches every directory below root, including ones created later
+    bool start(const std::string& root)
+    {
+#ifdef __linux__
+        if (running) return true;
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0)
+        {
+            spdlog::error("Hot reload: inotify is not available");
+            return false;
+        }
+
+        std::error_code ec;
+        addWatch(root);
+        for (const auto& item : std::filesystem::recursive_directory_iterator(root, std::filesystem::directory_options::follow_directory_symlink, ec))
+        {
+            if (item.is_directory()) addWatch(item.path().string());
+        }
+
+        running = true;
+        thread = std::thread([this] { watch(); });
+        spdlog::info("Hot reload: watching {} directories under {}", directories.size(), root);
+        return true;
+#else
+        spdlog::info("Hot reload is only available on Linux");
+        return false;
+#endif
+    }
+
+    void stop()
+    {
+#ifdef __linux__
+        if (!running) return;
+        running = false;
+        thread.join();
+        close(fd);
+        fd = -1;
+        directories.clear();
+#endif
+    }
+
+    // The callback runs on the GL thread after path changes; paths are compared in absolute, normalized form
+    uint64_t subscribe(const std::string& path, Callback callback)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const uint64_t id = ++lastSubscription;
+        const std::string key = normalize(path);
+        subscribers[key].push_back({ id, std::move(callback) });
+        pathById[id] = key;
+        return id;
+    }
+
+    void unsubscribe(uint64_t id)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto path = pathById.find(id);
+        if (path == pathById.end()) return;
+
+        auto& list = subscribers[path->second];
+        std::erase_if(list, [id](const Subscription& subscription) { return subscription.id == id; });
+        if (list.empty()) subscribers.erase(path->second);
+        pathById.erase(path);
+    }
+
+    // Queues work for the next update(); background reloads hand their results back through this
+    void post(Callback callback)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        posted.push_back(std::move(callback));
+    }
+
+    // Fires the callbacks of settled changes, then the posted work. Call once per frame on the GL thread.
+    void update()
+    {
+        std::vector<std::pair<std::string, Callback>> due;
+        std::vector<Callback> work;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const auto now = std::chrono::steady_clock::now();
+            for (auto it = changed.begin(); it != changed.end();)
+            {
+                if (now - it->second < SETTLE_TIME)
+                {
+                    ++it;
+                    continue;
+                }
+                if (const auto list = subscribers.find(it->first); list != subscribers.end())
+                {
+                    for (const Subscription& subscription : list->second) due.emplace_back(it->first, subscription.callback);
+                }
+                it = changed.erase(it);
+            }
+            work.swap(posted);
+        }
+
+        // Outside the lock, since callbacks subscribe and post themselves
+        for (const auto& [path, callback] : due)
+        {
+            spdlog::info("Hot reload: {} changed", path);
+            callback();
+        }
+        for (const Callback& callback : work)
+        {
+            callback();
+        }
+    }
+
+    static std::string normalize(const std::string& path)
+    {
+        std::error_code ec;
+        return std::filesystem::absolute(path, ec).lexically_normal().generic_string();
+    }
+
+private:
+    struct Subscription
+    {
+        uint64_t id;
+        Callback callback;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::vector<Subscription>> subscribers;
+    std::unordered_map<uint64_t, std::string> pathById;
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> changed; // path -> last event
+    std::vector<Callback> posted;
+    uint64_t lastSubscription = 0;
+
+    std::atomic<bool> running = false;
+    std::thread thread;
+    int fd = -1;
+    std::unordered_map<int, std::string> directories; // watch descriptor -> directory, watcher thread only after start()
+
+    AssetWatcher() = default;
+
+#ifdef __linux__
+    void addWatch(const std::string& directory)
+    {
+        const int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR);
+        if (wd >= 0) directories[wd] = directory;
+    }
+
+    void watch()
+    {
+        alignas(inotify_event) char buffer[16 * 1024];
+        pollfd descriptor{ fd, POLLIN, 0 };
+        while (running)
+        {
+            // Wakes up regularly to notice stop()
+            if (::poll(&descriptor, 1, 100) <= 0) continue;
+
+            ssize_t length;
+            while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+            {
+                for (char* p = buffer; p < buffer + length;)
+                {
+                    const auto* event = reinterpret_cast<const inotify_event*>(p);
+                    p += sizeof(inotify_event) + event->len;
+
+                    const auto directory = directories.find(event->wd);
+                    if (directory == directories.end() || event->len == 0) continue;
+                    const std::string path = directory->second + '/' + event->name;
+
+                    if (event->mask & IN_ISDIR)
+                    {
+                        if (event->mask & (IN_CREATE | IN_MOVED_TO)) addWatch(path);
+                        continue;
+                    }
+                    // A created file is reported again with IN_CLOSE_WRITE once its content is there
+                    if (event->mask & IN_CREATE) continue;
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    changed[normalize(path)] = std::chrono::steady_clock::now();
+                }
+            }
+        }
+    }
+#endif
+};
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+// S3TC comes from EXT_texture_compression_s3tc and its sRGB variants from EXT_texture_sRGB,
+// neither of which glad's core profile defines
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// Pixel formats cooked textures are stored in
+enum class TextureFormat : uint32_t
+{
+    R8,
+    RG8,
+    RGB8,
+    RGBA8,
+    BC1,  // RGB, 4 bpp
+    BC3,  // RGBA, 8 bpp
+    BC4,  // R, 4 bpp
+    BC5   // RG, 8 bpp
+};
+
+struct TextureFormatInfo
+{
+    uint32_t blockDimension;  // texels per block side, 1 for uncompressed formats
+    uint32_t blockBytes;
+    uint32_t vkFormat;        // KTX2 identifies formats by their Vulkan enum
+    GLenum internalFormat;
+    GLenum srgbInternalFormat; // used for gamma-corrected textures, 0 for formats without an sRGB variant
+    GLenum pixelFormat;       // upload format of uncompressed data, 0 for block formats
+    bool compressed;
+};
+
+inline const TextureFormatInfo& textureFormatInfo(TextureFormat format)
+{
+    static const TextureFormatInfo infos[] =
+    {
+        { 1, 1, 9, GL_R8, 0, GL_RED, false },
+        { 1, 2, 16, GL_RG8, 0, GL_RG, false },
+        { 1, 3, 23, GL_RGB8, GL_SRGB8, GL_RGB, false },
+        { 1, 4, 37, GL_RGBA8, GL_SRGB8_ALPHA8, GL_RGBA, false },
+        { 4, 8, 131, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, 0, true },
+        { 4, 16, 137, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 0, true },
+        { 4, 8, 139, GL_COMPRESSED_RED_RGTC1, 0, 0, true },
+        { 4, 16, 141, GL_COMPRESSED_RG_RGTC2, 0, 0, true },
+    };
+    return infos[static_cast<uint32_t>(format)];
+}
+
+inline size_t textureLevelSize(TextureFormat format, uint32_t width, uint32_t height)
+{
+    const TextureFormatInfo& info = textureFormatInfo(format);
+    const size_t blocksX = (width + info.blockDimension - 1) / info.blockDimension;
+    const size_t blocksY = (height + info.blockDimension - 1) / info.blockDimension;
+    return blocksX * blocksY * info.blockBytes;
+}
+
+// CPU encoder for the BCn block formats, run at cook time.
+// BC1 colors use a principal-axis fit refined by least squares; alpha, BC4 and BC5 channels
+// use the eight-value interpolation mode between their block minimum and maximum.
+class BlockCompression
+{
+public:
+    // Uncompressed and block formats a decoded image with this many channels is cooked to
+    static TextureFormat uncompressedFormat(int channels)
+    {
+        static constexpr TextureFormat formats[] = { TextureFormat::R8, TextureFormat::RG8, TextureFormat::RGB8, TextureFormat::RGBA8 };
+        return formats[std::clamp(channels, 1, 4) - 1];
+    }
+
+    static TextureFormat compressedFormat(const uint8_t* pixels, size_t texelCount, int channels)
+    {
+        switch (channels)
+        {
+        case 1: return TextureFormat::BC4;
+        case 2: return TextureFormat::BC5;
+        case 3: return TextureFormat::BC1;
+        default:
+            // Fully opaque RGBA does not need the extra alpha block
+            for (size_t i = 0; i < texelCount; i++)
+            {
+                if (pixels[i * 4 + 3] != 255) return TextureFormat::BC3;
+            }
+            return TextureFormat::BC1;
+        }
+    }
+
+    // pixels holds width * height texels of `channels` bytes; block edges past the image repeat the last texel
+    static std::vector<uint8_t> compress(const uint8_t* pixels, uint32_t width, uint32_t height, int channels, TextureFormat format)
+    {
+        std::vector<uint8_t> output(textureLevelSize(format, width, height));
+        const uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+        const size_t blockBytes = textureFormatInfo(format).blockBytes;
+
+        uint8_t block[16][4];
+        for (uint32_t by = 0; by < blocksY; by++)
+        {
+            for (uint32_t bx = 0; bx < blocksX; bx++)
+            {
+                for (uint32_t i = 0; i < 16; i++)
+                {
+                    const uint32_t x = std::min(bx * 4 + i % 4, width - 1);
+                    const uint32_t y = std::min(by * 4 + i / 4, height - 1);
+                    const uint8_t* texel = pixels + (static_cast<size_t>(y) * width + x) * channels;
+                    block[i][0] = texel[0];
+                    block[i][1] = channels > 1 ? texel[1] : 0;
+                    block[i][2] = channels > 2 ? texel[2] : 0;
+                    block[i][3] = channels > 3 ? texel[3] : 255;
+                    if (channels == 1) block[i][1] = block[i][2] = texel[0];
+                }
+
+                uint8_t* out = output.data() + (static_cast<size_t>(by) * blocksX + bx) * blockBytes;
+                switch (format)
+                {
+                case TextureFormat::BC1: encodeColor(block, out); break;
+                case TextureFormat::BC3: encodeChannel(block, 3, out); encodeColor(block, out + 8); break;
+                case TextureFormat::BC4: encodeChannel(block, 0, out); break;
+                case TextureFormat::BC5: encodeChannel(block, 0, out); encodeChannel(block, 1, out + 8); break;
+                default: break;
+                }
+            }
+        }
+        return output;
+    }
+
+private:
+    static uint16_t packColor565(const float color[3])
+    {
+        const auto r = static_cast<uint16_t>(std::lround(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f));
+        const auto g = static_cast<uint16_t>(std::lround(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f));
+        const auto b = static_cast<uint16_t>(std::lround(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f));
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    static void unpackColor565(uint16_t packed, int color[3])
+    {
+        const int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    // Picks the nearest of the four palette entries per texel and returns the squared error
+    static uint32_t assignColorIndices(const uint8_t block[16][4], uint16_t color0, uint16_t color1, uint8_t indices[16])
+    {
+        int palette[4][3];
+        unpackColor565(color0, palette[0]);
+        unpackColor565(color1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        uint32_t total = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            uint32_t best = UINT32_MAX;
+            for (uint8_t p = 0; p < 4; p++)
+            {
+                uint32_t error = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    const int d = block[i][c] - palette[p][c];
+                    error += static_cast<uint32_t>(d * d);
+                }
+                if (error < best)
+                {
+                    best = error;
+                    indices[i] = p;
+                }
+            }
+            total += best;
+        }
+        return total;
+    }
+
+    static void encodeColor(const uint8_t block[16][4], uint8_t out[8])
+    {
+        // Principal axis of the block's colors through power iteration on the covariance
+        float mean[3] = { 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; i++)
+        {
+            for (int c = 0; c < 3; c++) mean[c] += block[i][c] / 16.0f;
+        }
+        float covariance[6] = {};
+        for (int i = 0; i < 16; i++)
+        {
+            const float r = block[i][0] - mean[0], g = block[i][1] - mean[1], b = block[i][2] - mean[2];
+            covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+            covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+        }
+        float axis[3] = { 1.0f, 1.0f, 1.0f };
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            const float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+            const float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+            const float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+            const float length = std::max({ std::fabs(x), std::fabs(y), std::fabs(z) });
+            if (length < 1e-6f) break;
+            axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+        }
+
+        // Extremes along the axis are the first endpoint guess
+        float minProjection = std::numeric_limits<float>::max(), maxProjection = -std::numeric_limits<float>::max();
+        for (int i = 0; i < 16; i++)
+        {
+            const float projection = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+            minProjection = std::min(minProjection, projection);
+            maxProjection = std::max(maxProjection, projection);
+        }
+        const float axisLengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+        float high[3], low[3];
+        for (int c = 0; c < 3; c++)
+        {
+            high[c] = mean[c] + axis[c] * maxProjection / std::max(axisLengthSquared, 1e-6f);
+            low[c] = mean[c] + axis[c] * minProjection / std::max(axisLengthSquared, 1e-6f);
+        }
+
+        uint16_t color0 = packColor565(high), color1 = packColor565(low);
+        uint8_t indices[16];
+        uint32_t error = assignColorIndices(block, color0, color1, indices);
+
+        // One least-squares refit of the endpoints for the chosen indices
+        static constexpr float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        float aa = 0.0f, bb = 0.0f, ab = 0.0f, ax[3] = {}, bx[3] = {};
+        for (int i = 0; i < 16; i++)
+        {
+            const float a = weights[indices[i]], b = 1.0f - a;
+            aa += a * a; bb += b * b; ab += a * b;
+            for (int c = 0; c < 3; c++)
+            {
+                ax[c] += a * block[i][c];
+                bx[c] += b * block[i][c];
+            }
+        }
+        const float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) > 1e-6f)
+        {
+            float refinedHigh[3], refinedLow[3];
+            for (int c = 0; c < 3; c++)
+            {
+                refinedHigh[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+                refinedLow[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+            }
+            const uint16_t refined0 = packColor565(refinedHigh), refined1 = packColor565(refinedLow);
+            uint8_t refinedIndices[16];
+            const uint32_t refinedError = assignColorIndices(block, refined0, refined1, refinedIndices);
+            if (refinedError < error)
+            {
+                color0 = refined0;
+                color1 = refined1;
+                error = refinedError;
+                std::memcpy(indices, refinedIndices, sizeof(indices));
+            }
+        }
+
+        // color0 > color1 selects the four-color mode; swapping the endpoints swaps index pairs
+        if (color0 < color1)
+        {
+            std::swap(color0, color1);
+            static constexpr uint8_t swapped[4] = { 1, 0, 3, 2 };
+            for (uint8_t& index : indices) index = swapped[index];
+        }
+        else if (color0 == color1)
+        {
+            std::memset(indices, 0, sizeof(indices));
+        }
+
+        uint32_t bits = 0;
+        for (int i = 0; i < 16; i++) bits |= static_cast<uint32_t>(indices[i]) << (i * 2);
+        out[0] = static_cast<uint8_t>(color0);
+        out[1] = static_cast<uint8_t>(color0 >> 8);
+        out[2] = static_cast<uint8_t>(color1);
+        out[3] = static_cast<uint8_t>(color1 >> 8);
+        std::memcpy(out + 4, &bits, sizeof(bits));
+    }
+
+    // BC4 block of one channel, also the alpha half of BC3 and both halves of BC5
+    static void encodeChannel(const uint8_t block[16][4], int channel, uint8_t out[8])
+    {
+        uint8_t minimum = 255, maximum = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            minimum = std::min(minimum, block[i][channel]);
+            maximum = std::max(maximum, block[i][channel]);
+        }
+
+        out[0] = maximum;
+        out[1] = minimum;
+        uint64_t bits = 0;
+        if (maximum > minimum)
+        {
+            // Palette order is max, min, then six steps from max towards min
+            static constexpr uint8_t toIndex[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+            const int range = maximum - minimum;
+            for (int i = 0; i < 16; i++)
+            {
+                const int step = ((maximum - block[i][channel]) * 14 + range) / (2 * range);
+                bits |= static_cast<uint64_t>(toIndex[step]) << (i * 3);
+            }
+        }
+        for (int b = 0; b < 6; b++) out[2 + b] = static_cast<uint8_t>(bits >> (b * 8));
+    }
+};
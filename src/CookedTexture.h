@@ -0,0 +1,346 @@
+#pragma once
+
+#include <stb_image.h>
+
+#include "AssetHash.h"
+#include "BlockCompression.h"
+#include "MeshCache.h"
+#include "VirtualFileSystem.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+// Cooked textures are KTX2 files (Khronos KTX 2.0, no supercompression) holding the full mip chain,
+// block compressed unless the cooker was told otherwise. The source they were cooked from is
+// recorded in the key/value data, so stale files are detected like stale mesh caches.
+constexpr uint32_t COOKED_TEXTURE_VERSION = 2;
+constexpr const char* COOKED_TEXTURE_DIR = "cache/textures";
+
+struct Ktx2Header
+{
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+
+struct Ktx2Level
+{
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+static_assert(sizeof(Ktx2Header) == 80, "Ktx2Header must match the KTX2 file header");
+
+class CookedTexture
+{
+public:
+    static constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+    static std::string cachePathFor(const std::string& sourcePath)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.ktx2", static_cast<unsigned long long>(hashString(MeshCache::normalizePath(sourcePath))));
+        return std::string(COOKED_TEXTURE_DIR) + '/' + name;
+    }
+
+    // Opens the cooked file of sourcePath; fails when there is none or the source changed since
+    bool open(const std::string& sourcePath)
+    {
+        header = nullptr;
+        file = VirtualFileSystem::instance().open(cachePathFor(sourcePath));
+        if (!file.isOpen()) return false;
+
+        if (file.size() < sizeof(Ktx2Header)) return reject();
+        header = reinterpret_cast<const Ktx2Header*>(file.data());
+        if (std::memcmp(header->identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) return reject();
+        if (!formatFromVk(header->vkFormat, textureFormat)) return reject();
+        if (header->pixelDepth != 0 || header->layerCount != 0 || (header->faceCount != 1 && header->faceCount != 6)) return reject();
+        if (header->levelCount == 0 || header->supercompressionScheme != 0) return reject();
+        if (sizeof(Ktx2Header) + static_cast<uint64_t>(header->levelCount) * sizeof(Ktx2Level) > file.size()) return reject();
+        if (static_cast<uint64_t>(header->kvdByteOffset) + header->kvdByteLength > file.size()) return reject();
+
+        levels = reinterpret_cast<const Ktx2Level*>(file.data() + sizeof(Ktx2Header));
+        for (uint32_t i = 0; i < header->levelCount; i++)
+        {
+            const size_t expected = textureLevelSize(textureFormat, levelWidth(i), levelHeight(i)) * header->faceCount;
+            if (levels[i].byteOffset + levels[i].byteLength > file.size() || levels[i].byteLength != expected) return reject();
+        }
+
+        // The cooker owns these files, so a stale one is left for it to replace instead of being patched here
+        SourceStamp stamp;
+        const std::string_view source = value("OpenGLGP.source");
+        if (source != MeshCache::normalizePath(sourcePath)) return reject();
+        const std::string stampText(value("OpenGLGP.sourceStamp"));
+        unsigned long long size = 0, hash = 0;
+        long long mtime = 0;
+        if (std::sscanf(stampText.c_str(), "%llu %lld %llx", &size, &mtime, &hash) != 3) return reject();
+        stamp.size = size;
+        stamp.mtime = mtime;
+        stamp.hash = hash;
+        contentHash = hash;
+        bool touched = false;
+        return VirtualFileSystem::instance().stampMatches(stamp, sourcePath, touched) ? true : reject();
+    }
+
+    bool isOpen() const { return header != nullptr; }
+    TextureFormat format() const { return textureFormat; }
+    uint32_t faceCount() const { return header->faceCount; }
+    uint32_t levelCount() const { return header->levelCount; }
+    uint32_t levelWidth(uint32_t level) const { return std::max(header->pixelWidth >> level, 1u); }
+    uint32_t levelHeight(uint32_t level) const { return std::max(header->pixelHeight >> level, 1u); }
+    size_t faceSize(uint32_t level) const { return static_cast<size_t>(levels[level].byteLength / header->faceCount); }
+    const uint8_t* faceData(uint32_t level, uint32_t face = 0) const { return file.data() + levels[level].byteOffset + faceSize(level) * face; }
+
+    // hashBytes of the source file this was cooked from, as recorded at cook time
+    uint64_t sourceHash() const { return contentHash; }
+
+    // Decodes sourcePath, builds the mip chain on the CPU, compresses it when asked and writes the KTX2 file
+    static bool cook(const std::string& sourcePath, bool compress)
+    {
+        SourceStamp stamp;
+        if (!SourceStamp::capture(sourcePath, stamp)) return false;
+
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(sourcePath.c_str(), &width, &height, &channels, 0);
+        if (pixels == nullptr) return false;
+
+        std::vector<std::vector<uint8_t>> chain;
+        chain.emplace_back(pixels, pixels + static_cast<size_t>(width) * height * channels);
+        stbi_image_free(pixels);
+        for (uint32_t w = static_cast<uint32_t>(width), h = static_cast<uint32_t>(height); w > 1 || h > 1; w = std::max(w / 2, 1u), h = std::max(h / 2, 1u))
+        {
+            chain.push_back(downsample(chain.back(), w, h, std::max(w / 2, 1u), std::max(h / 2, 1u), channels));
+        }
+
+        const TextureFormat format = compress
+            ? BlockCompression::compressedFormat(chain[0].data(), static_cast<size_t>(width) * height, channels)
+            : BlockCompression::uncompressedFormat(channels);
+        if (textureFormatInfo(format).compressed)
+        {
+            for (uint32_t level = 0; level < chain.size(); level++)
+            {
+                chain[level] = BlockCompression::compress(chain[level].data(), std::max(static_cast<uint32_t>(width) >> level, 1u),
+                    std::max(static_cast<uint32_t>(height) >> level, 1u), channels, format);
+            }
+        }
+
+        char stampText[64];
+        std::snprintf(stampText, sizeof(stampText), "%llu %lld %016llx", static_cast<unsigned long long>(stamp.size),
+            static_cast<long long>(stamp.mtime), static_cast<unsigned long long>(stamp.hash));
+        return write(cachePathFor(sourcePath), format, static_cast<uint32_t>(width), static_cast<uint32_t>(height), chain,
+            { { "KTXwriter", "OpenGLGP AssetCooker" }, { "OpenGLGP.source", MeshCache::normalizePath(sourcePath) }, { "OpenGLGP.sourceStamp", stampText } });
+    }
+
+private:
+    FileData file;
+    const Ktx2Header* header = nullptr;
+    const Ktx2Level* levels = nullptr;
+    TextureFormat textureFormat = TextureFormat::RGBA8;
+    uint64_t contentHash = 0;
+
+    bool reject()
+    {
+        file = FileData();
+        header = nullptr;
+        return false;
+    }
+
+    static bool formatFromVk(uint32_t vkFormat, TextureFormat& format)
+    {
+        for (uint32_t f = 0; f <= static_cast<uint32_t>(TextureFormat::BC5); f++)
+        {
+            if (textureFormatInfo(static_cast<TextureFormat>(f)).vkFormat == vkFormat)
+            {
+                format = static_cast<TextureFormat>(f);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Value of a NUL-terminated string entry in the key/value data, empty when missing
+    std::string_view value(std::string_view key) const
+    {
+        const uint8_t* p = file.data() + header->kvdByteOffset;
+        const uint8_t* end = p + header->kvdByteLength;
+        while (end - p >= 4)
+        {
+            uint32_t length;
+            std::memcpy(&length, p, sizeof(length));
+            p += 4;
+            if (length > static_cast<size_t>(end - p)) break;
+            const std::string_view entry(reinterpret_cast<const char*>(p), length);
+            const size_t separator = entry.find('\0');
+            if (separator != std::string_view::npos && entry.substr(0, separator) == key)
+            {
+                std::string_view result = entry.substr(separator + 1);
+                if (!result.empty() && result.back() == '\0') result.remove_suffix(1);
+                return result;
+            }
+            p += (length + 3) & ~3u;
+        }
+        return {};
+    }
+
+    // Basic data format descriptor (Khronos Data Format 1.3) for the formats we write
+    static std::vector<uint8_t> dataFormatDescriptor(TextureFormat format)
+    {
+        struct Sample { uint16_t bitOffset; uint8_t bitLength; uint8_t channel; };
+        const TextureFormatInfo& info = textureFormatInfo(format);
+        uint8_t colorModel = 1; // RGBSDA
+        std::vector<Sample> samples;
+        switch (format)
+        {
+        case TextureFormat::BC1: colorModel = 128; samples = { { 0, 64, 0 } }; break;
+        case TextureFormat::BC3: colorModel = 130; samples = { { 0, 64, 15 }, { 64, 64, 0 } }; break;
+        case TextureFormat::BC4: colorModel = 131; samples = { { 0, 64, 0 } }; break;
+        case TextureFormat::BC5: colorModel = 132; samples = { { 0, 64, 0 }, { 64, 64, 1 } }; break;
+        default:
+            {
+                static constexpr uint8_t channels[4] = { 0, 1, 2, 15 };
+                for (uint32_t c = 0; c < info.blockBytes; c++) samples.push_back({ static_cast<uint16_t>(c * 8), 8, channels[c] });
+            }
+            break;
+        }
+
+        const auto blockSize = static_cast<uint16_t>(24 + 16 * samples.size());
+        std::vector<uint8_t> dfd(4 + blockSize, 0);
+        auto put32 = [&](size_t offset, uint32_t value) { std::memcpy(dfd.data() + offset, &value, sizeof(value)); };
+        put32(0, static_cast<uint32_t>(dfd.size()));
+        put32(4, 0);                                // vendor Khronos, descriptor type basic
+        put32(8, 2u | (static_cast<uint32_t>(blockSize) << 16)); // version 2
+        dfd[12] = colorModel;
+        dfd[13] = 1;                                // BT.709 primaries
+        dfd[14] = 1;                                // linear transfer
+        dfd[15] = 0;                                // straight alpha
+        dfd[16] = static_cast<uint8_t>(info.blockDimension - 1);
+        dfd[17] = static_cast<uint8_t>(info.blockDimension - 1);
+        dfd[20] = static_cast<uint8_t>(info.blockBytes);
+        for (size_t s = 0; s < samples.size(); s++)
+        {
+            const size_t offset = 28 + 16 * s;
+            std::memcpy(dfd.data() + offset, &samples[s].bitOffset, sizeof(uint16_t));
+            dfd[offset + 2] = static_cast<uint8_t>(samples[s].bitLength - 1);
+            dfd[offset + 3] = samples[s].channel;
+            put32(offset + 8, 0);
+            put32(offset + 12, info.compressed ? 0xFFFFFFFFu : 255u);
+        }
+        return dfd;
+    }
+
+    static bool write(const std::string& cachePath, TextureFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& chain,
+        const std::vector<std::pair<std::string, std::string>>& keyValues)
+    {
+        const TextureFormatInfo& info = textureFormatInfo(format);
+        const std::vector<uint8_t> dfd = dataFormatDescriptor(format);
+
+        std::vector<uint8_t> kvd;
+        for (const auto& [key, text] : keyValues)
+        {
+            const auto length = static_cast<uint32_t>(key.size() + 1 + text.size() + 1);
+            kvd.insert(kvd.end(), reinterpret_cast<const uint8_t*>(&length), reinterpret_cast<const uint8_t*>(&length) + sizeof(length));
+            kvd.insert(kvd.end(), key.begin(), key.end());
+            kvd.push_back(0);
+            kvd.insert(kvd.end(), text.begin(), text.end());
+            kvd.push_back(0);
+            kvd.resize((kvd.size() + 3) & ~static_cast<size_t>(3), 0);
+        }
+
+        Ktx2Header fileHeader{};
+        std::memcpy(fileHeader.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+        fileHeader.vkFormat = info.vkFormat;
+        fileHeader.typeSize = 1;
+        fileHeader.pixelWidth = width;
+        fileHeader.pixelHeight = height;
+        fileHeader.faceCount = 1;
+        fileHeader.levelCount = static_cast<uint32_t>(chain.size());
+        fileHeader.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2Header) + chain.size() * sizeof(Ktx2Level));
+        fileHeader.dfdByteLength = static_cast<uint32_t>(dfd.size());
+        fileHeader.kvdByteOffset = fileHeader.dfdByteOffset + fileHeader.dfdByteLength;
+        fileHeader.kvdByteLength = static_cast<uint32_t>(kvd.size());
+
+        // KTX2 stores the smallest level first, each aligned to lcm(texel block size, 4)
+        const uint64_t alignment = std::lcm(static_cast<uint64_t>(info.blockBytes), uint64_t{ 4 });
+        std::vector<Ktx2Level> levelIndex(chain.size());
+        uint64_t offset = fileHeader.kvdByteOffset + fileHeader.kvdByteLength;
+        for (size_t i = chain.size(); i-- > 0;)
+        {
+            offset = (offset + alignment - 1) / alignment * alignment;
+            levelIndex[i] = { offset, chain[i].size(), chain[i].size() };
+            offset += chain[i].size();
+        }
+
+        const std::string tempPath = cachePath + ".tmp";
+        std::error_code ec;
+        std::filesystem::create_directories(COOKED_TEXTURE_DIR, ec);
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out) return false;
+            out.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+            out.write(reinterpret_cast<const char*>(levelIndex.data()), static_cast<std::streamsize>(levelIndex.size() * sizeof(Ktx2Level)));
+            out.write(reinterpret_cast<const char*>(dfd.data()), static_cast<std::streamsize>(dfd.size()));
+            out.write(reinterpret_cast<const char*>(kvd.data()), static_cast<std::streamsize>(kvd.size()));
+            for (size_t i = chain.size(); i-- > 0;)
+            {
+                static constexpr char zeros[16] = {};
+                out.write(zeros, static_cast<std::streamsize>(levelIndex[i].byteOffset - static_cast<uint64_t>(out.tellp())));
+                out.write(reinterpret_cast<const char*>(chain[i].data()), static_cast<std::streamsize>(chain[i].size()));
+            }
+            if (!out) return false;
+        }
+        std::filesystem::rename(tempPath, cachePath, ec);
+        return !ec;
+    }
+
+    // 2x2 box filter; odd source sizes fold their last row or column into the final texel
+    static std::vector<uint8_t> downsample(const std::vector<uint8_t>& source, uint32_t width, uint32_t height, uint32_t newWidth, uint32_t newHeight, int channels)
+    {
+        std::vector<uint8_t> result(static_cast<size_t>(newWidth) * newHeight * channels);
+        for (uint32_t y = 0; y < newHeight; y++)
+        {
+            const uint32_t y0 = std::min(y * 2, height - 1);
+            const uint32_t y1 = y + 1 == newHeight ? height - 1 : std::min(y * 2 + 1, height - 1);
+            for (uint32_t x = 0; x < newWidth; x++)
+            {
+                const uint32_t x0 = std::min(x * 2, width - 1);
+                const uint32_t x1 = x + 1 == newWidth ? width - 1 : std::min(x * 2 + 1, width - 1);
+                for (int c = 0; c < channels; c++)
+                {
+                    uint32_t sum = 0, count = 0;
+                    for (uint32_t sy = y0; sy <= y1; sy++)
+                    {
+                        for (uint32_t sx = x0; sx <= x1; sx++)
+                        {
+                            sum += source[(static_cast<size_t>(sy) * width + sx) * channels + c];
+                            count++;
+                        }
+                    }
+                    result[(static_cast<size_t>(y) * newWidth + x) * channels + c] = static_cast<uint8_t>((sum + count / 2) / count);
+                }
+            }
+        }
+        return result;
+    }
+};
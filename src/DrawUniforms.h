@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Shader.h"
+
+#include <iterator>
+#include <string>
+#include <string_view>
+
+// Uniforms set for every object and mesh drawn through the scene graph: model by Node, the rest by
+// Mesh::draw. Resolved once per program, so a draw sets them by handle without hashing names.
+struct DrawUniforms
+{
+    static constexpr int SAMPLERS_PER_TYPE = 4;
+    static constexpr const char* SAMPLER_TYPES[] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_height" };
+    static constexpr int SAMPLER_COUNT = static_cast<int>(std::size(SAMPLER_TYPES)) * SAMPLERS_PER_TYPE;
+
+    UniformHandle model, positionScale, positionOffset;
+    UniformHandle samplers[SAMPLER_COUNT]; // "texture_diffuse1" .. "texture_height4", see samplerSlot()
+
+    DrawUniforms() = default;
+
+    explicit DrawUniforms(Shader& shader)
+        : model(shader.uniform("model")), positionScale(shader.uniform("positionScale")), positionOffset(shader.uniform("positionOffset"))
+    {
+        for (int type = 0; type < static_cast<int>(std::size(SAMPLER_TYPES)); type++)
+        {
+            for (int number = 1; number <= SAMPLERS_PER_TYPE; number++)
+            {
+                samplers[samplerSlot(SAMPLER_TYPES[type], number)] = shader.uniform(std::string(SAMPLER_TYPES[type]) + std::to_string(number));
+            }
+        }
+    }
+
+    // Index into samplers of the number-th (from 1) texture of a type, -1 when no sampler has that name
+    static int samplerSlot(std::string_view type, int number)
+    {
+        if (number < 1 || number > SAMPLERS_PER_TYPE) return -1;
+        for (int i = 0; i < static_cast<int>(std::size(SAMPLER_TYPES)); i++)
+        {
+            if (type == SAMPLER_TYPES[i]) return i * SAMPLERS_PER_TYPE + number - 1;
+        }
+        return -1;
+    }
+};
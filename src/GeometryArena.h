@@ -0,0 +1,401 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+#include "ImportSettings.h"
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Offset allocator over a linear range of units. Free blocks are kept by offset, to merge
+// neighbours on release, and by size, for best-fit placement.
+class RangeAllocator
+{
+public:
+    static constexpr uint32_t INVALID = ~0u;
+
+    uint32_t allocate(uint32_t size)
+    {
+        if (size == 0) return 0;
+        const auto fit = bySize.lower_bound(size);
+        if (fit == bySize.end()) return INVALID;
+
+        const uint32_t blockSize = fit->first;
+        const uint32_t offset = fit->second;
+        bySize.erase(fit);
+        byOffset.erase(offset);
+        if (blockSize > size) insert(offset + size, blockSize - size);
+        usedUnits += size;
+        return offset;
+    }
+
+    void free(uint32_t offset, uint32_t size)
+    {
+        if (size == 0) return;
+        usedUnits -= size;
+
+        auto next = byOffset.lower_bound(offset);
+        if (next != byOffset.end() && next->first == offset + size)
+        {
+            size += next->second;
+            erase(next);
+        }
+        auto previous = byOffset.lower_bound(offset);
+        if (previous != byOffset.begin() && std::prev(previous)->first + std::prev(previous)->second == offset)
+        {
+            --previous;
+            offset = previous->first;
+            size += previous->second;
+            erase(previous);
+        }
+        insert(offset, size);
+    }
+
+    // Extends the range; the new units become free and merge with a free block at the old end
+    void grow(uint32_t newCapacity)
+    {
+        if (newCapacity <= capacityUnits) return;
+        const uint32_t oldCapacity = capacityUnits;
+        capacityUnits = newCapacity;
+        usedUnits += newCapacity - oldCapacity;
+        free(oldCapacity, newCapacity - oldCapacity);
+    }
+
+    // Forgets the free list after the owner packed every allocation into [0, used)
+    void compact()
+    {
+        byOffset.clear();
+        bySize.clear();
+        if (usedUnits < capacityUnits) insert(usedUnits, capacityUnits - usedUnits);
+    }
+
+    uint32_t capacity() const { return capacityUnits; }
+    uint32_t used() const { return usedUnits; }
+    uint32_t largestFree() const { return bySize.empty() ? 0 : bySize.rbegin()->first; }
+    size_t fragments() const { return byOffset.size(); }
+
+private:
+    std::map<uint32_t, uint32_t> byOffset;      // offset -> size
+    std::multimap<uint32_t, uint32_t> bySize;   // size -> offset
+    uint32_t capacityUnits = 0;
+    uint32_t usedUnits = 0;
+
+    void insert(uint32_t offset, uint32_t size)
+    {
+        byOffset.emplace(offset, size);
+        bySize.emplace(size, offset);
+    }
+
+    void erase(std::map<uint32_t, uint32_t>::iterator block)
+    {
+        auto [first, last] = bySize.equal_range(block->second);
+        for (auto it = first; it != last; ++it)
+        {
+            if (it->second == block->first)
+            {
+                bySize.erase(it);
+                break;
+            }
+        }
+        byOffset.erase(block);
+    }
+};
+
+// Where one mesh lives inside its arena; indices are relative to baseVertex
+struct GeometryRange
+{
+    GLint baseVertex = 0;
+    GLuint vertexCount = 0;
+    GLuint firstIndex = 0;
+    GLuint indexCount = 0;
+};
+
+// Shared vertex and index buffers for every mesh of one vertex format, behind a single VAO.
+// Meshes sub-allocate ranges and draw with glDrawElementsBaseVertex, so the scene costs three
+// GL objects per format instead of three per mesh. Ranges can move when the arena compacts
+// itself, so they are looked up through their id at draw time rather than cached.
+// All calls must come from the thread that owns the GL context.
+class GeometryArena
+{
+public:
+    static constexpr uint32_t INITIAL_VERTICES = 1u << 16;
+    static constexpr uint32_t INITIAL_INDICES = 1u << 18;
+
+    static GeometryArena& forFormat(VertexFormat format)
+    {
+        static GeometryArena arenas[] = { GeometryArena(VertexFormat::Float), GeometryArena(VertexFormat::Compact), GeometryArena(VertexFormat::Quantized) };
+        return arenas[static_cast<size_t>(format)];
+    }
+
+    // Deletes the GL objects of every arena; call before the context goes away
+    static void releaseAll()
+    {
+        for (VertexFormat format : { VertexFormat::Float, VertexFormat::Compact, VertexFormat::Quantized })
+        {
+            forFormat(format).release();
+        }
+    }
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    // Maps the new ranges and lets fill write the vertices, packed for this arena's format, and the
+    // indices in place, so imported or decoded data reaches the buffers without a staging copy. The mappings are write-only
+    // (and usually write-combined): fill must write them front to back and never read them.
+    uint32_t allocate(uint32_t vertexCount, uint32_t indexCount, const std::function<void(void* vertices, GLuint* indices)>& fill)
+    {
+        const GeometryRange range = reserve(vertexCount, indexCount);
+
+        // The index buffer is mapped through COPY_READ, since binding it as ELEMENT_ARRAY would change the VAO
+        constexpr GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+        void* vertices = nullptr;
+        void* indices = nullptr;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+        glBindBuffer(GL_COPY_READ_BUFFER, indexBuffer);
+        if (vertexCount > 0)
+        {
+            vertices = glMapBufferRange(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(range.baseVertex) * stride, static_cast<GLsizeiptr>(vertexCount) * stride, access);
+        }
+        if (indexCount > 0)
+        {
+            indices = glMapBufferRange(GL_COPY_READ_BUFFER, static_cast<GLintptr>(range.firstIndex) * sizeof(GLuint), static_cast<GLsizeiptr>(indexCount) * sizeof(GLuint), access);
+        }
+
+        if ((vertices != nullptr || vertexCount == 0) && (indices != nullptr || indexCount == 0))
+        {
+            fill(vertices, static_cast<GLuint*>(indices));
+        }
+        else
+        {
+            spdlog::error("Geometry arena {}: cannot map {} vertices, {} indices", static_cast<int>(format), vertexCount, indexCount);
+        }
+        if (vertices != nullptr) glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        if (indices != nullptr) glUnmapBuffer(GL_COPY_READ_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        return track(range);
+    }
+
+    void free(uint32_t id)
+    {
+        Slot& slot = slots[id];
+        if (!slot.live) return;
+        vertexSpace.free(static_cast<uint32_t>(slot.range.baseVertex), slot.range.vertexCount);
+        indexSpace.free(slot.range.firstIndex, slot.range.indexCount);
+        slot.live = false;
+        freeSlots.push_back(id);
+    }
+
+    const GeometryRange& range(uint32_t id) const { return slots[id].range; }
+
+    void bind() const { glBindVertexArray(vao); }
+
+    // Packs every live range to the front of fresh buffers, leaving one free block at the end of each
+    void defragment()
+    {
+        if (vao == 0) return;
+
+        std::vector<uint32_t> live;
+        for (uint32_t id = 0; id < slots.size(); id++)
+        {
+            if (slots[id].live) live.push_back(id);
+        }
+        std::sort(live.begin(), live.end(), [this](uint32_t a, uint32_t b) { return slots[a].range.baseVertex < slots[b].range.baseVertex; });
+
+        const GLuint packedVertices = createBuffer(static_cast<GLsizeiptr>(vertexSpace.capacity()) * stride);
+        const GLuint packedIndices = createBuffer(static_cast<GLsizeiptr>(indexSpace.capacity()) * sizeof(GLuint));
+        GLint vertexCursor = 0;
+        GLuint indexCursor = 0;
+        for (uint32_t id : live)
+        {
+            GeometryRange& range = slots[id].range;
+            copy(vertexBuffer, packedVertices, static_cast<GLintptr>(range.baseVertex) * stride, static_cast<GLintptr>(vertexCursor) * stride, static_cast<GLsizeiptr>(range.vertexCount) * stride);
+            copy(indexBuffer, packedIndices, static_cast<GLintptr>(range.firstIndex) * sizeof(GLuint), static_cast<GLintptr>(indexCursor) * sizeof(GLuint), static_cast<GLsizeiptr>(range.indexCount) * sizeof(GLuint));
+            range.baseVertex = vertexCursor;
+            range.firstIndex = indexCursor;
+            vertexCursor += static_cast<GLint>(range.vertexCount);
+            indexCursor += range.indexCount;
+        }
+        vertexSpace.compact();
+        indexSpace.compact();
+        replaceBuffers(packedVertices, packedIndices);
+        spdlog::info("Geometry arena {}: compacted {} meshes into {} vertices, {} indices", static_cast<int>(format), live.size(), vertexCursor, indexCursor);
+    }
+
+    uint32_t vertexCapacity() const { return vertexSpace.capacity(); }
+    uint32_t indexCapacity() const { return indexSpace.capacity(); }
+    uint32_t verticesUsed() const { return vertexSpace.used(); }
+    uint32_t indicesUsed() const { return indexSpace.used(); }
+
+private:
+    struct Slot
+    {
+        GeometryRange range;
+        bool live = false;
+    };
+
+    VertexFormat format;
+    size_t stride;
+    GLuint vao = 0, vertexBuffer = 0, indexBuffer = 0;
+    RangeAllocator vertexSpace, indexSpace;
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+
+    explicit GeometryArena(VertexFormat format) : format(format), stride(VertexPacking::stride(format)) {}
+
+    void create()
+    {
+        glGenVertexArrays(1, &vao);
+        vertexSpace.grow(INITIAL_VERTICES);
+        indexSpace.grow(INITIAL_INDICES);
+        replaceBuffers(createBuffer(static_cast<GLsizeiptr>(INITIAL_VERTICES) * stride), createBuffer(static_cast<GLsizeiptr>(INITIAL_INDICES) * sizeof(GLuint)));
+    }
+
+    void release()
+    {
+        if (vao == 0) return;
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &vertexBuffer);
+        glDeleteBuffers(1, &indexBuffer);
+        vao = vertexBuffer = indexBuffer = 0;
+    }
+
+    GeometryRange reserve(uint32_t vertexCount, uint32_t indexCount)
+    {
+        if (vao == 0) create();
+        if (vertexSpace.largestFree() < vertexCount || indexSpace.largestFree() < indexCount)
+        {
+            makeRoom(vertexCount, indexCount);
+        }
+
+        GeometryRange range;
+        range.baseVertex = static_cast<GLint>(vertexSpace.allocate(vertexCount));
+        range.vertexCount = vertexCount;
+        range.firstIndex = indexSpace.allocate(indexCount);
+        range.indexCount = indexCount;
+        return range;
+    }
+
+    uint32_t track(const GeometryRange& range)
+    {
+        uint32_t id;
+        if (!freeSlots.empty())
+        {
+            id = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else
+        {
+            id = static_cast<uint32_t>(slots.size());
+            slots.emplace_back();
+        }
+        slots[id] = { range, true };
+        return id;
+    }
+
+    // Compacting is enough while the free space adds up; otherwise the short buffer grows
+    void makeRoom(uint32_t vertexCount, uint32_t indexCount)
+    {
+        if (vertexSpace.capacity() - vertexSpace.used() >= vertexCount && indexSpace.capacity() - indexSpace.used() >= indexCount)
+        {
+            defragment();
+            return;
+        }
+
+        GLuint grownVertices = vertexBuffer, grownIndices = indexBuffer;
+        if (vertexSpace.largestFree() < vertexCount)
+        {
+            const uint32_t capacity = std::max(vertexSpace.capacity() * 2, vertexSpace.capacity() + vertexCount);
+            grownVertices = createBuffer(static_cast<GLsizeiptr>(capacity) * stride);
+            copy(vertexBuffer, grownVertices, 0, 0, static_cast<GLsizeiptr>(vertexSpace.capacity()) * stride);
+            vertexSpace.grow(capacity);
+        }
+        if (indexSpace.largestFree() < indexCount)
+        {
+            const uint32_t capacity = std::max(indexSpace.capacity() * 2, indexSpace.capacity() + indexCount);
+            grownIndices = createBuffer(static_cast<GLsizeiptr>(capacity) * sizeof(GLuint));
+            copy(indexBuffer, grownIndices, 0, 0, static_cast<GLsizeiptr>(indexSpace.capacity()) * sizeof(GLuint));
+            indexSpace.grow(capacity);
+        }
+        replaceBuffers(grownVertices, grownIndices);
+        spdlog::info("Geometry arena {}: grown to {} vertices, {} indices", static_cast<int>(format), vertexSpace.capacity(), indexSpace.capacity());
+    }
+
+    // Points the VAO at new buffers and deletes the ones they replace
+    void replaceBuffers(GLuint vertices, GLuint indices)
+    {
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vertices);
+        VertexPacking::setupAttributes(format);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        if (vertices != vertexBuffer) glDeleteBuffers(1, &vertexBuffer);
+        if (indices != indexBuffer) glDeleteBuffers(1, &indexBuffer);
+        vertexBuffer = vertices;
+        indexBuffer = indices;
+    }
+
+    static GLuint createBuffer(GLsizeiptr size)
+    {
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return buffer;
+    }
+
+    static void copy(GLuint source, GLuint destination, GLintptr sourceOffset, GLintptr destinationOffset, GLsizeiptr size)
+    {
+        if (size == 0) return;
+        glBindBuffer(GL_COPY_READ_BUFFER, source);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sourceOffset, destinationOffset, size);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+};
+
+// Owns one range in an arena and frees it on destruction; move-only, like the mesh holding it
+class GeometryHandle
+{
+public:
+    GeometryHandle() = default;
+    GeometryHandle(GeometryArena& arena, uint32_t id) : owner(&arena), id(id) {}
+    GeometryHandle(GeometryHandle&& other) noexcept : owner(std::exchange(other.owner, nullptr)), id(other.id) {}
+
+    GeometryHandle& operator=(GeometryHandle&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            owner = std::exchange(other.owner, nullptr);
+            id = other.id;
+        }
+        return *this;
+    }
+
+    ~GeometryHandle() { reset(); }
+
+    void reset()
+    {
+        if (owner) owner->free(id);
+        owner = nullptr;
+    }
+
+    explicit operator bool() const { return owner != nullptr; }
+    GeometryArena& arena() const { return *owner; }
+    const GeometryRange& range() const { return owner->range(id); }
+
+private:
+    GeometryArena* owner = nullptr;
+    uint32_t id = 0;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "AssetHash.h"
+
+#include <cstdint>
+
+// GPU vertex layouts a mesh can be uploaded with
+enum class VertexFormat : uint32_t
+{
+    Float,     // 32 bytes: float position, normal and texture coordinates
+    Compact,   // 20 bytes: float position, 10:10:10:2 normal, half-float texture coordinates
+    Quantized  // 16 bytes: like Compact, with 16-bit positions dequantized by a per-mesh transform
+};
+
+// Options applied while importing a model. Everything here changes the cooked output, so it is part of the cache key.
+struct ImportSettings
+{
+    VertexFormat vertexFormat = VertexFormat::Float;
+
+    // Merge meshes that share a material into one, with node transforms baked in, so each material is one draw call
+    bool mergeByMaterial = true;
+
+    // Vertices whose attributes all differ by at most these amounts are merged at import; zero merges exact duplicates only
+    float weldPositionEpsilon = 0.000001f; // relative to the mesh bounds diagonal
+    float weldNormalEpsilon = 0.001f;
+    float weldTexCoordEpsilon = 0.00001f;
+
+    // Largest allowed quantization error; meshes that exceed it fall back to a wider format
+    float maxPositionError = 0.0005f;  // relative to the mesh bounds diagonal
+    float maxNormalError = 0.01f;      // length of the difference vector between unit normals
+    float maxTexCoordError = 0.001f;   // in UV units
+
+    // Levels of detail generated below the full mesh, each with about lodReduction times the triangles of the previous
+    int lodLevels = 3;
+    float lodReduction = 0.5f;
+
+    uint64_t key(uint64_t seed) const
+    {
+        uint64_t hash = hashBytes(&vertexFormat, sizeof(vertexFormat), seed);
+        hash = hashBytes(&mergeByMaterial, sizeof(mergeByMaterial), hash);
+        hash = hashBytes(&weldPositionEpsilon, sizeof(weldPositionEpsilon), hash);
+        hash = hashBytes(&weldNormalEpsilon, sizeof(weldNormalEpsilon), hash);
+        hash = hashBytes(&weldTexCoordEpsilon, sizeof(weldTexCoordEpsilon), hash);
+        hash = hashBytes(&maxPositionError, sizeof(maxPositionError), hash);
+        hash = hashBytes(&maxNormalError, sizeof(maxNormalError), hash);
+        hash = hashBytes(&maxTexCoordError, sizeof(maxTexCoordError), hash);
+        hash = hashBytes(&lodLevels, sizeof(lodLevels), hash);
+        return hashBytes(&lodReduction, sizeof(lodReduction), hash);
+    }
+};
@@ -26,7 +26,7 @@ LightPosition::LightPosition()
 LightPosition::~LightPosition() = default;
 
 // We do that to be able to make LightPosition a SceneObject so that it can be added as a Node to a scene
-void LightPosition::draw(const Shader& shader) const {}
+void LightPosition::draw(const Shader& shader, const DrawUniforms& uniforms) const {}
 
 void LightPosition::drawSphere(glm::vec3 position, glm::vec4 color, glm::mat4 proview) const
 {
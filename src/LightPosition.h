@@ -12,7 +12,7 @@ public:
 
     LightPosition();
     ~LightPosition() override;
-    void draw(const Shader& shader) const override;
+    void draw(const Shader& shader, const DrawUniforms& uniforms) const override;
 
     void drawSphere(glm::vec3 position, glm::vec4 color, glm::mat4 proview) const;
     void drawArrow(glm::vec3 start, glm::vec3 end, glm::vec4 color, glm::mat4 proview) const;
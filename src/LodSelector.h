@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// Picks a level of detail from how much of the screen an object's bounding sphere covers.
+// Level n is used below a coverage of 0.5 / 2^n of the viewport height, so each halving
+// of the projected size drops one level. Switching back and forth at a boundary is avoided
+// by only leaving the current level once the coverage is HYSTERESIS past the threshold.
+class LodSelector
+{
+public:
+    static constexpr float FIRST_THRESHOLD = 0.5f;
+    static constexpr float HYSTERESIS = 0.1f;
+
+    // Call once per frame before drawing, with the projection the scene is drawn with
+    static void setView(const glm::vec3& cameraPosition, const glm::mat4& projection)
+    {
+        view().cameraPosition = cameraPosition;
+        view().projectionScale = projection[1][1];
+    }
+
+    static int select(const glm::mat4& world, const glm::vec3& boundsMin, const glm::vec3& boundsMax, int lodCount, int current)
+    {
+        if (lodCount <= 1) return 0;
+
+        const float worldScale = std::max({ glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2])) });
+        const glm::vec3 center = glm::vec3(world * glm::vec4((boundsMin + boundsMax) * 0.5f, 1.0f));
+        const float radius = glm::length(boundsMax - boundsMin) * 0.5f * worldScale;
+        const float distance = glm::length(center - view().cameraPosition);
+        if (distance <= radius) return 0;
+
+        // Fraction of the viewport height covered by the sphere's diameter
+        const float coverage = radius * view().projectionScale / distance;
+        const int finest = levelFor(coverage * (1.0f + HYSTERESIS), lodCount);
+        const int coarsest = levelFor(coverage * (1.0f - HYSTERESIS), lodCount);
+        return std::clamp(current, finest, coarsest);
+    }
+
+private:
+    struct View
+    {
+        glm::vec3 cameraPosition = glm::vec3(0.0f);
+        float projectionScale = 1.0f;
+    };
+
+    static View& view()
+    {
+        static View instance;
+        return instance;
+    }
+
+    static int levelFor(float coverage, int lodCount)
+    {
+        int level = 0;
+        float threshold = FIRST_THRESHOLD;
+        while (level + 1 < lodCount && coverage < threshold)
+        {
+            level++;
+            threshold *= 0.5f;
+        }
+        return level;
+    }
+};
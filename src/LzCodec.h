@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Byte-oriented LZ77 in the LZ4 block layout: each sequence is a token (literal count in the
+// high nibble, match length - MIN_MATCH in the low one), extra length bytes for nibbles of 15,
+// the literals, then a little-endian 16-bit match offset. The last sequence stops after its
+// literals. Compression is a single greedy pass over a hash of 4-byte prefixes; decompression
+// is a bounds-checked copy loop, fast enough to run on every read of a packed asset.
+class LzCodec
+{
+public:
+    static constexpr size_t MIN_MATCH = 4;
+    static constexpr size_t MAX_OFFSET = 65535;
+
+    static std::vector<uint8_t> compress(const uint8_t* source, size_t size)
+    {
+        std::vector<uint8_t> out;
+        out.reserve(size + size / 255 + 16);
+
+        std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0); // position + 1 of the last prefix seen, 0 when none
+        size_t anchor = 0, i = 0;
+        while (size >= MIN_MATCH && i <= size - MIN_MATCH)
+        {
+            const uint32_t prefix = read32(source + i);
+            uint32_t& slot = table[(prefix * 2654435761u) >> (32 - HASH_BITS)];
+            const size_t candidate = slot;
+            slot = static_cast<uint32_t>(i + 1);
+
+            if (candidate == 0 || i - (candidate - 1) > MAX_OFFSET || read32(source + candidate - 1) != prefix)
+            {
+                i++;
+                continue;
+            }
+
+            const size_t match = candidate - 1;
+            size_t length = MIN_MATCH;
+            while (i + length < size && source[match + length] == source[i + length]) length++;
+
+            const size_t literals = i - anchor;
+            const size_t extra = length - MIN_MATCH;
+            out.push_back(static_cast<uint8_t>((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(extra, 15)));
+            if (literals >= 15) writeLength(out, literals - 15);
+            out.insert(out.end(), source + anchor, source + i);
+            const size_t offset = i - match;
+            out.push_back(static_cast<uint8_t>(offset & 0xFF));
+            out.push_back(static_cast<uint8_t>(offset >> 8));
+            if (extra >= 15) writeLength(out, extra - 15);
+
+            i += length;
+            anchor = i;
+        }
+
+        const size_t literals = size - anchor;
+        out.push_back(static_cast<uint8_t>(std::min<size_t>(literals, 15) << 4));
+        if (literals >= 15) writeLength(out, literals - 15);
+        out.insert(out.end(), source + anchor, source + size);
+        return out;
+    }
+
+    // Fails on malformed input and unless the output comes to exactly size bytes
+    static bool decompress(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t size)
+    {
+        const uint8_t* in = source;
+        const uint8_t* const inEnd = source + sourceSize;
+        uint8_t* out = destination;
+        uint8_t* const outEnd = destination + size;
+
+        while (in < inEnd)
+        {
+            const uint8_t token = *in++;
+            size_t literals = token >> 4;
+            if (literals == 15 && !readLength(in, inEnd, literals)) return false;
+            if (literals > static_cast<size_t>(inEnd - in) || literals > static_cast<size_t>(outEnd - out)) return false;
+            // Short runs copy a fixed 16 bytes when both buffers have room; the excess is overwritten later
+            if (literals <= 16 && inEnd - in >= 16 && outEnd - out >= 16) std::memcpy(out, in, 16);
+            else if (literals > 0) std::memcpy(out, in, literals); // empty streams may come with null buffers
+            in += literals;
+            out += literals;
+            if (in == inEnd) break;
+
+            if (inEnd - in < 2) return false;
+            const size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+            in += 2;
+            if (offset == 0 || offset > static_cast<size_t>(out - destination)) return false;
+
+            size_t length = token & 15;
+            if (length == 15 && !readLength(in, inEnd, length)) return false;
+            length += MIN_MATCH;
+            if (length > static_cast<size_t>(outEnd - out)) return false;
+
+            // An overlapping match repeats its last offset bytes, so it is copied offset bytes at a time
+            const uint8_t* match = out - offset;
+            if (offset >= 16 && length <= 16 && outEnd - out >= 16) std::memcpy(out, match, 16);
+            else if (offset >= length) std::memcpy(out, match, length);
+            else if (offset == 1) std::memset(out, *match, length);
+            else for (size_t copied = 0; copied < length; copied += offset) std::memcpy(out + copied, match + copied, std::min(offset, length - copied));
+            out += length;
+        }
+        return out == outEnd;
+    }
+
+private:
+    static constexpr int HASH_BITS = 16;
+
+    static uint32_t read32(const uint8_t* p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    static void writeLength(std::vector<uint8_t>& out, size_t length)
+    {
+        for (; length >= 255; length -= 255) out.push_back(255);
+        out.push_back(static_cast<uint8_t>(length));
+    }
+
+    static bool readLength(const uint8_t*& in, const uint8_t* end, size_t& length)
+    {
+        uint8_t byte;
+        do
+        {
+            if (in == end) return false;
+            byte = *in++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+};
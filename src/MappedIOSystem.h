@@ -0,0 +1,101 @@
+#pragma once
+
+#include <assimp/DefaultIOSystem.h>
+#include <assimp/IOStream.hpp>
+
+#include "VirtualFileSystem.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+
+// Assimp stream over a file opened through VirtualFileSystem: reads are plain copies out of the
+// page cache or a package entry, without stdio buffering or a system call per small read
+class MappedIOStream : public Assimp::IOStream
+{
+public:
+    explicit MappedIOStream(FileData file) : file(std::move(file)) {}
+
+    size_t Read(void* buffer, size_t size, size_t count) override
+    {
+        if (size == 0) return 0;
+        const size_t available = (file.size() - position) / size;
+        const size_t items = std::min(count, available);
+        std::memcpy(buffer, file.data() + position, items * size);
+        position += items * size;
+        return items;
+    }
+
+    size_t Write(const void*, size_t, size_t) override
+    {
+        return 0;
+    }
+
+    aiReturn Seek(size_t offset, aiOrigin origin) override
+    {
+        size_t target;
+        switch (origin)
+        {
+        case aiOrigin_SET: target = offset; break;
+        case aiOrigin_CUR: target = position + offset; break;
+        case aiOrigin_END: target = file.size() - offset; break;
+        default: return aiReturn_FAILURE;
+        }
+        if (target > file.size()) return aiReturn_FAILURE;
+        position = target;
+        return aiReturn_SUCCESS;
+    }
+
+    size_t Tell() const override
+    {
+        return position;
+    }
+
+    size_t FileSize() const override
+    {
+        return file.size();
+    }
+
+    void Flush() override
+    {
+    }
+
+private:
+    FileData file;
+    size_t position = 0;
+};
+
+// File access for Assimp through MappedIOStream. Packed files always come from their package;
+// loose files that cannot be mapped (writes, empty files) go through Assimp's default stdio
+// streams, as do all loose files while disabled, which keeps both paths available for comparison.
+class MappedIOSystem : public Assimp::DefaultIOSystem
+{
+public:
+    explicit MappedIOSystem(bool enabled = true) : enabled(enabled) {}
+
+    bool Exists(const char* file) const override
+    {
+        return VirtualFileSystem::instance().exists(file);
+    }
+
+    Assimp::IOStream* Open(const char* file, const char* mode = "rb") override
+    {
+        if (std::strchr(mode, 'w') == nullptr && std::strchr(mode, 'a') == nullptr && std::strchr(mode, '+') == nullptr)
+        {
+            FileData packed = VirtualFileSystem::instance().openPacked(file);
+            if (packed.isOpen()) return new MappedIOStream(std::move(packed));
+
+            auto mapped = std::make_shared<MappedFile>();
+            if (enabled && mapped->open(file))
+            {
+                mapped->adviseSequential();
+                return new MappedIOStream(FileData::fromMapping(std::move(mapped)));
+            }
+        }
+        return Assimp::DefaultIOSystem::Open(file, mode);
+    }
+
+private:
+    bool enabled;
+};
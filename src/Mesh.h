@@ -4,105 +4,174 @@
 
 #include <Shader.h>
 
+#include "DrawUniforms.h"
+#include "GeometryArena.h"
+#include "MeshData.h"
+#include "StreamCodec.h"
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <span>
 #include <string>
 #include <vector>
 using namespace std;
 
-#define MAX_BONE_INFLUENCE 4
-
-struct Vertex {
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec2 texCoords;
-};
-
-struct Texture {
-    GLuint id;
-    string type;
-    string path;
-};
-
+// Geometry lives in the shared GeometryArena of the mesh's vertex format; the mesh only owns its range there.
+// vertices and indices stay empty unless the mesh was created with keepCpuData, for CPU-side queries
+// such as raycasts or collision; everything else only needs the GPU copy.
 class Mesh {
 public:
-    GLuint VAO, VBO, EBO;
+    GeometryHandle geometry;
     vector<Vertex> vertices;
     vector<GLuint> indices;
+    vector<MeshLod> lods;
     vector<Texture> textures;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    VertexFormat format = VertexFormat::Float;
 
-    Mesh(const vector<Vertex>& vertices, const vector<GLuint>& indices, const vector<Texture>& textures)
+    Mesh(const vector<Vertex>& vertices, const vector<GLuint>& indices, const vector<Texture>& textures, bool keepCpuData = false)
     {
-        this->vertices = vertices;
-        this->indices = indices;
         this->textures = textures;
-        setupMesh();
+        assignSamplers();
+        this->lods = { { 0, static_cast<uint32_t>(indices.size()), 0.0f } };
+        setupMesh(vertices, indices);
+        if (keepCpuData)
+        {
+            this->vertices = vertices;
+            this->indices = indices;
+        }
     }
 
-    void draw(const Shader& shader) const
+    // Writes the view straight into mapped arena buffers; encoded cache streams are decoded in place
+    Mesh(const MeshView& view, const vector<Texture>& textures, bool keepCpuData = false)
     {
-        GLuint diffuseNr = 1;
-        GLuint specularNr = 1;
-        GLuint normalNr = 1;
-        GLuint heightNr = 1;
-        for (GLuint i = 0; i < textures.size(); i++)
+        const uint32_t indexCount = view.encoded() ? view.encodedIndexCount : static_cast<uint32_t>(view.indices.size());
+        this->lods.assign(view.lods.begin(), view.lods.end());
+        if (this->lods.empty()) this->lods = { { 0, indexCount, 0.0f } };
+        this->textures = textures;
+        assignSamplers();
+        this->boundsMin = view.boundsMin;
+        this->boundsMax = view.boundsMax;
+        this->format = view.format;
+
+        if (!keepCpuData)
         {
-            glActiveTexture(GL_TEXTURE0 + i);
-            string number;
-            string name = textures[i].type;
-            if (name == "texture_diffuse")
-            {
-                number = std::to_string(diffuseNr++);
-            }
-            else if (name == "texture_specular")
-            {
-                number = std::to_string(specularNr++);
-            }
-            else if (name == "texture_normal")
-            {
-                number = std::to_string(normalNr++);
-            }
-            else if (name == "texture_height")
+            if (view.encoded()) setupEncodedMesh(view);
+            else setupMesh(view.vertices, view.indices);
+            return;
+        }
+
+        // With a CPU copy wanted anyway, it is built first and uploaded from
+        if (view.encoded())
+        {
+            this->vertices.resize(view.encodedVertexCount);
+            this->indices.resize(view.encodedIndexCount);
+            if (!StreamCodec::decode(view.encodedVertices.data(), view.encodedVertices.size(), this->vertices.data(), this->vertices.size(), sizeof(Vertex)) ||
+                !StreamCodec::decode(view.encodedIndices.data(), view.encodedIndices.size(), this->indices.data(), this->indices.size(), sizeof(GLuint)) ||
+                !indicesInRange(this->indices, this->vertices.size()))
             {
-                number = std::to_string(heightNr++);
+                std::cout << "ERROR::MESH::CORRUPT_CACHE_STREAM" << std::endl;
+                std::fill(this->indices.begin(), this->indices.end(), 0u);
             }
-            glUniform1i(glGetUniformLocation(shader.id, (name + number).c_str()), i);
+        }
+        else
+        {
+            this->vertices.assign(view.vertices.begin(), view.vertices.end());
+            this->indices.assign(view.indices.begin(), view.indices.end());
+        }
+        setupMesh(this->vertices, this->indices);
+    }
+
+    // lod is clamped to the levels this mesh has; 0 is full detail. The caller binds the arena first
+    // (geometry.arena().bind()), once for any run of meshes in the same vertex format.
+    void draw(const Shader& shader, const DrawUniforms& uniforms, int lod = 0) const
+    {
+        // Set for every mesh, since the program keeps whatever the previous mesh left behind
+        shader.setVec3(uniforms.positionScale, VertexPacking::positionScale(format, boundsMin, boundsMax));
+        shader.setVec3(uniforms.positionOffset, VertexPacking::positionOffset(format, boundsMin));
+
+        for (GLuint i = 0; i < textures.size(); i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + i);
+            if (samplerSlots[i] >= 0) shader.setInt(uniforms.samplers[samplerSlots[i]], static_cast<int>(i));
             glBindTexture(GL_TEXTURE_2D, textures[i].id);
         }
         //draw mesh
-        glBindVertexArray(VAO);
-
-        glDrawElements(GL_TRIANGLES, static_cast<GLint>(indices.size()), GL_UNSIGNED_INT, nullptr);
-        glBindVertexArray(0);
+        const GeometryRange& range = geometry.range();
+        const MeshLod& level = lods[std::clamp(lod, 0, static_cast<int>(lods.size()) - 1)];
+        glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(level.indexCount), GL_UNSIGNED_INT,
+            reinterpret_cast<void*>(static_cast<uintptr_t>(range.firstIndex + level.firstIndex) * sizeof(GLuint)), range.baseVertex);
         glActiveTexture(GL_TEXTURE0);
     }
 
 private:
+    vector<int> samplerSlots; // per texture: its DrawUniforms::samplers index, numbered per type ("texture_diffuse1" and so on)
 
-    void setupMesh()
+    void assignSamplers()
     {
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
-
-        //vertices
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), static_cast<void*>(nullptr));
+        int numbers[std::size(DrawUniforms::SAMPLER_TYPES)] = {};
+        samplerSlots.clear();
+        for (const Texture& texture : textures)
+        {
+            int slot = -1;
+            for (size_t type = 0; type < std::size(DrawUniforms::SAMPLER_TYPES); type++)
+            {
+                if (texture.type == DrawUniforms::SAMPLER_TYPES[type]) slot = DrawUniforms::samplerSlot(texture.type, ++numbers[type]);
+            }
+            samplerSlots.push_back(slot);
+        }
+    }
 
-        //normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, normal)));
+    void setupMesh(span<const Vertex> vertexData, span<const GLuint> indexData)
+    {
+        GeometryArena& arena = GeometryArena::forFormat(format);
+        const auto vertexCount = static_cast<uint32_t>(vertexData.size());
+        const auto indexCount = static_cast<uint32_t>(indexData.size());
+        geometry = GeometryHandle(arena, arena.allocate(vertexCount, indexCount, [&](void* vertexOut, GLuint* indexOut)
+        {
+            VertexPacking::packInto(vertexData, format, boundsMin, boundsMax, static_cast<uint8_t*>(vertexOut));
+            std::copy(indexData.begin(), indexData.end(), indexOut);
+        }));
+    }
 
-        //textures
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, texCoords)));
+    // A stream that decodes cleanly can still index past the mesh's vertices, and with base vertex
+    // drawing that reads the neighbouring meshes in the arena
+    static bool indicesInRange(span<const GLuint> indexData, size_t vertexCount)
+    {
+        return std::all_of(indexData.begin(), indexData.end(), [vertexCount](GLuint index) { return index < vertexCount; });
+    }
 
-        glBindVertexArray(0);
+    void setupEncodedMesh(const MeshView& view)
+    {
+        GeometryArena& arena = GeometryArena::forFormat(format);
+        geometry = GeometryHandle(arena, arena.allocate(view.encodedVertexCount, view.encodedIndexCount, [&](void* vertexOut, GLuint* indexOut)
+        {
+            // Indices are checked against the vertex count before they reach the GPU, and reading them
+            // back from the write-only mapping would be slow, so they go through a scratch buffer
+            thread_local vector<GLuint> indexScratch;
+            indexScratch.resize(view.encodedIndexCount);
+            bool decoded = StreamCodec::decode(view.encodedIndices.data(), view.encodedIndices.size(), indexScratch.data(), indexScratch.size(), sizeof(GLuint)) &&
+                indicesInRange(indexScratch, view.encodedVertexCount);
+            if (decoded) std::copy(indexScratch.begin(), indexScratch.end(), indexOut);
+            if (format == VertexFormat::Float)
+            {
+                decoded = decoded && StreamCodec::decode(view.encodedVertices.data(), view.encodedVertices.size(), vertexOut, view.encodedVertexCount, sizeof(Vertex));
+            }
+            else
+            {
+                // Packing needs whole vertices, so these go through a scratch buffer first
+                thread_local vector<Vertex> scratch;
+                scratch.resize(view.encodedVertexCount);
+                decoded = decoded && StreamCodec::decode(view.encodedVertices.data(), view.encodedVertices.size(), scratch.data(), scratch.size(), sizeof(Vertex));
+                if (decoded) VertexPacking::packInto(scratch, format, boundsMin, boundsMax, static_cast<uint8_t*>(vertexOut));
+            }
+            if (!decoded)
+            {
+                // Degenerate triangles draw nothing, and the index range is all the GPU ever reads
+                std::cout << "ERROR::MESH::CORRUPT_CACHE_STREAM" << std::endl;
+                std::fill_n(indexOut, view.encodedIndexCount, 0u);
+            }
+        }));
     }
 };
@@ -0,0 +1,353 @@
+#pragma once
+
+#include "AssetHash.h"
+#include "MeshData.h"
+#include "StreamCodec.h"
+#include "VirtualFileSystem.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// Cooked mesh cache file layout (native endianness, every blob 16-byte aligned):
+//   MeshCacheHeader
+//   MeshCacheEntry[meshCount]
+//   MeshCacheTextureRef[textureRefCount]
+//   MeshCacheDependency[dependencyCount]
+//   MeshLod[lodCount]
+//   string table (source path first, then texture types and paths, then dependency paths)
+//   vertex and index streams referenced by the entries, encoded with StreamCodec
+constexpr uint32_t MESH_CACHE_MAGIC = 0x4843534D; // "MSCH"
+constexpr uint32_t MESH_CACHE_VERSION = 8;
+constexpr const char* MESH_CACHE_DIR = "cache/meshes";
+
+struct MeshCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t importKey;      // hash of the import settings the file was cooked with
+    uint64_t sourceHash;     // content hash of the source asset
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint32_t meshCount;
+    uint32_t textureRefCount;
+    uint32_t lodCount;
+    uint32_t dependencyCount;
+    uint64_t stringTableOffset;
+    uint32_t stringTableSize;
+    uint32_t sourcePathLength;
+};
+
+struct MeshCacheEntry
+{
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t vertexStreamSize; // encoded bytes
+    uint64_t indexStreamSize;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t firstTextureRef;
+    uint32_t textureRefCount;
+    float boundsMin[3];
+    float boundsMax[3];
+    uint32_t vertexFormat;
+    uint32_t firstLod;
+    uint32_t lodCount;
+    uint32_t reserved;
+};
+
+struct MeshCacheTextureRef
+{
+    uint32_t typeOffset;
+    uint32_t typeLength;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+};
+
+// Another file the import read (.mtl, ...), stamped like the source in the header
+struct MeshCacheDependency
+{
+    uint64_t size;
+    int64_t mtime;
+    uint64_t hash;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+};
+
+class MeshCache
+{
+public:
+    // Cache files are named after the normalized source path, so "res/a.obj" and "res/./a.obj" share one entry
+    static std::string normalizePath(const std::string& sourcePath)
+    {
+        return std::filesystem::path(sourcePath).lexically_normal().generic_string();
+    }
+
+    static std::string cachePathFor(const std::string& sourcePath)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.mesh", static_cast<unsigned long long>(hashString(normalizePath(sourcePath))));
+        return std::string(MESH_CACHE_DIR) + '/' + name;
+    }
+
+    // Opens the cache file of sourcePath and checks it against the source and every file the import read,
+    // packed or on disk. A changed mtime alone does not invalidate the cache as long as the content hash still matches.
+    bool open(const std::string& sourcePath, uint64_t importKey)
+    {
+        const std::string cachePath = cachePathFor(sourcePath);
+        file = VirtualFileSystem::instance().open(cachePath);
+        if (!file.isOpen()) return false;
+
+        if (file.size() < sizeof(MeshCacheHeader)) return reject();
+        header = reinterpret_cast<const MeshCacheHeader*>(file.data());
+        if (header->magic != MESH_CACHE_MAGIC || header->version != MESH_CACHE_VERSION || header->importKey != importKey) return reject();
+
+        const uint64_t tablesEnd = sizeof(MeshCacheHeader)
+            + static_cast<uint64_t>(header->meshCount) * sizeof(MeshCacheEntry)
+            + static_cast<uint64_t>(header->textureRefCount) * sizeof(MeshCacheTextureRef)
+            + static_cast<uint64_t>(header->dependencyCount) * sizeof(MeshCacheDependency)
+            + static_cast<uint64_t>(header->lodCount) * sizeof(MeshLod);
+        if (tablesEnd > file.size() || header->stringTableOffset + header->stringTableSize > file.size()) return reject();
+
+        entries = reinterpret_cast<const MeshCacheEntry*>(file.data() + sizeof(MeshCacheHeader));
+        textureRefs = reinterpret_cast<const MeshCacheTextureRef*>(entries + header->meshCount);
+        dependencies = reinterpret_cast<const MeshCacheDependency*>(textureRefs + header->textureRefCount);
+        lods = reinterpret_cast<const MeshLod*>(dependencies + header->dependencyCount);
+        strings = reinterpret_cast<const char*>(file.data() + header->stringTableOffset);
+
+        if (std::string_view(strings, header->sourcePathLength) != normalizePath(sourcePath)) return reject();
+        for (uint32_t i = 0; i < header->meshCount; i++)
+        {
+            const MeshCacheEntry& entry = entries[i];
+            if (entry.vertexOffset + entry.vertexStreamSize > file.size() || entry.vertexStreamSize == 0 ||
+                entry.indexOffset + entry.indexStreamSize > file.size() || entry.indexStreamSize == 0 ||
+                entry.firstTextureRef + entry.textureRefCount > header->textureRefCount ||
+                entry.vertexFormat > static_cast<uint32_t>(VertexFormat::Quantized) ||
+                entry.lodCount == 0 || static_cast<uint64_t>(entry.firstLod) + entry.lodCount > header->lodCount)
+            {
+                return reject();
+            }
+
+            // Mesh::draw takes these ranges as they are, and the arena holds other meshes right after this one
+            for (uint32_t lod = entry.firstLod; lod < entry.firstLod + entry.lodCount; lod++)
+            {
+                if (static_cast<uint64_t>(lods[lod].firstIndex) + lods[lod].indexCount > entry.indexCount || lods[lod].indexCount % 3 != 0) return reject();
+            }
+        }
+
+        for (uint32_t i = 0; i < header->dependencyCount; i++)
+        {
+            if (static_cast<uint64_t>(dependencies[i].pathOffset) + dependencies[i].pathLength > header->stringTableSize) return reject();
+        }
+
+        const VirtualFileSystem& vfs = VirtualFileSystem::instance();
+        const SourceStamp stamp{ header->sourceSize, header->sourceMtime, header->sourceHash };
+        bool touched = false;
+        if (!vfs.stampMatches(stamp, sourcePath, touched)) return reject();
+        if (touched) refreshMtime(cachePath, offsetof(MeshCacheHeader, sourceMtime), fileModificationTime(sourcePath));
+
+        for (uint32_t i = 0; i < header->dependencyCount; i++)
+        {
+            const MeshCacheDependency& dependency = dependencies[i];
+            const std::string dependencyPath(strings + dependency.pathOffset, dependency.pathLength);
+            if (!vfs.stampMatches({ dependency.size, dependency.mtime, dependency.hash }, dependencyPath, touched)) return reject();
+            if (touched)
+            {
+                const uint64_t offset = reinterpret_cast<const uint8_t*>(&dependency.mtime) - file.data();
+                refreshMtime(cachePath, offset, fileModificationTime(dependencyPath));
+            }
+        }
+        return true;
+    }
+
+    size_t meshCount() const { return file.isOpen() ? header->meshCount : 0; }
+
+    // Files besides the source that the cached import read, for hot reload to watch
+    std::vector<std::string> dependencyPaths() const
+    {
+        std::vector<std::string> paths;
+        for (uint32_t i = 0; file.isOpen() && i < header->dependencyCount; i++)
+        {
+            paths.emplace_back(strings + dependencies[i].pathOffset, dependencies[i].pathLength);
+        }
+        return paths;
+    }
+
+    MeshView mesh(size_t index) const
+    {
+        const MeshCacheEntry& entry = entries[index];
+        MeshView view;
+        view.encodedVertices = { file.data() + entry.vertexOffset, entry.vertexStreamSize };
+        view.encodedIndices = { file.data() + entry.indexOffset, entry.indexStreamSize };
+        view.encodedVertexCount = entry.vertexCount;
+        view.encodedIndexCount = entry.indexCount;
+        view.lods = { lods + entry.firstLod, entry.lodCount };
+        for (uint32_t i = 0; i < entry.textureRefCount; i++)
+        {
+            const MeshCacheTextureRef& ref = textureRefs[entry.firstTextureRef + i];
+            view.textureRefs.push_back({ string(strings + ref.typeOffset, ref.typeLength), string(strings + ref.pathOffset, ref.pathLength) });
+        }
+        view.boundsMin = glm::vec3(entry.boundsMin[0], entry.boundsMin[1], entry.boundsMin[2]);
+        view.boundsMax = glm::vec3(entry.boundsMax[0], entry.boundsMax[1], entry.boundsMax[2]);
+        view.format = static_cast<VertexFormat>(entry.vertexFormat);
+        return view;
+    }
+
+    // dependencies are the files ModelImporter::import() read; the source itself may be among them
+    static bool write(const std::string& sourcePath, uint64_t importKey, const std::vector<MeshData>& meshes, const std::vector<std::string>& dependencies)
+    {
+        MeshCacheHeader fileHeader{};
+        fileHeader.magic = MESH_CACHE_MAGIC;
+        fileHeader.version = MESH_CACHE_VERSION;
+        fileHeader.importKey = importKey;
+        SourceStamp stamp;
+        if (!VirtualFileSystem::instance().captureStamp(sourcePath, stamp)) return false;
+        fileHeader.sourceHash = stamp.hash;
+        fileHeader.sourceSize = stamp.size;
+        fileHeader.sourceMtime = stamp.mtime;
+        fileHeader.meshCount = static_cast<uint32_t>(meshes.size());
+
+        std::string stringTable = normalizePath(sourcePath);
+        fileHeader.sourcePathLength = static_cast<uint32_t>(stringTable.size());
+
+        std::vector<MeshCacheEntry> fileEntries(meshes.size());
+        std::vector<MeshCacheTextureRef> fileRefs;
+        std::vector<MeshLod> fileLods;
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            fileEntries[i].firstLod = static_cast<uint32_t>(fileLods.size());
+            fileEntries[i].lodCount = static_cast<uint32_t>(meshes[i].lods.size());
+            fileLods.insert(fileLods.end(), meshes[i].lods.begin(), meshes[i].lods.end());
+            fileEntries[i].firstTextureRef = static_cast<uint32_t>(fileRefs.size());
+            fileEntries[i].textureRefCount = static_cast<uint32_t>(meshes[i].textureRefs.size());
+            for (const TextureRef& ref : meshes[i].textureRefs)
+            {
+                MeshCacheTextureRef fileRef{};
+                fileRef.typeOffset = appendString(stringTable, ref.type, fileRef.typeLength);
+                fileRef.pathOffset = appendString(stringTable, ref.path, fileRef.pathLength);
+                fileRefs.push_back(fileRef);
+            }
+        }
+        std::vector<MeshCacheDependency> fileDependencies;
+        std::vector<std::string> seen = { normalizePath(sourcePath) };
+        for (const std::string& dependency : dependencies)
+        {
+            // Assimp may open the same file more than once
+            const std::string normalized = normalizePath(dependency);
+            if (std::find(seen.begin(), seen.end(), normalized) != seen.end()) continue;
+            seen.push_back(normalized);
+
+            if (!VirtualFileSystem::instance().captureStamp(normalized, stamp)) return false;
+            MeshCacheDependency fileDependency{};
+            fileDependency.size = stamp.size;
+            fileDependency.mtime = stamp.mtime;
+            fileDependency.hash = stamp.hash;
+            fileDependency.pathOffset = appendString(stringTable, normalized, fileDependency.pathLength);
+            fileDependencies.push_back(fileDependency);
+        }
+
+        fileHeader.textureRefCount = static_cast<uint32_t>(fileRefs.size());
+        fileHeader.dependencyCount = static_cast<uint32_t>(fileDependencies.size());
+        fileHeader.lodCount = static_cast<uint32_t>(fileLods.size());
+        fileHeader.stringTableOffset = sizeof(MeshCacheHeader) + fileEntries.size() * sizeof(MeshCacheEntry)
+            + fileRefs.size() * sizeof(MeshCacheTextureRef) + fileDependencies.size() * sizeof(MeshCacheDependency)
+            + fileLods.size() * sizeof(MeshLod);
+        fileHeader.stringTableSize = static_cast<uint32_t>(stringTable.size());
+
+        std::vector<std::vector<uint8_t>> vertexStreams(meshes.size()), indexStreams(meshes.size());
+        uint64_t offset = align(fileHeader.stringTableOffset + stringTable.size());
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            vertexStreams[i] = StreamCodec::encode(meshes[i].vertices.data(), meshes[i].vertices.size(), sizeof(Vertex));
+            indexStreams[i] = StreamCodec::encode(meshes[i].indices.data(), meshes[i].indices.size(), sizeof(GLuint));
+
+            MeshCacheEntry& entry = fileEntries[i];
+            entry.vertexCount = static_cast<uint32_t>(meshes[i].vertices.size());
+            entry.indexCount = static_cast<uint32_t>(meshes[i].indices.size());
+            entry.vertexOffset = offset;
+            entry.vertexStreamSize = vertexStreams[i].size();
+            offset = align(offset + entry.vertexStreamSize);
+            entry.indexOffset = offset;
+            entry.indexStreamSize = indexStreams[i].size();
+            offset = align(offset + entry.indexStreamSize);
+            std::memcpy(entry.boundsMin, &meshes[i].boundsMin[0], sizeof(entry.boundsMin));
+            std::memcpy(entry.boundsMax, &meshes[i].boundsMax[0], sizeof(entry.boundsMax));
+            entry.vertexFormat = static_cast<uint32_t>(meshes[i].format);
+        }
+
+        const std::string cachePath = cachePathFor(sourcePath);
+        const std::string tempPath = cachePath + ".tmp";
+        std::error_code ec;
+        std::filesystem::create_directories(MESH_CACHE_DIR, ec);
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out) return false;
+            out.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+            out.write(reinterpret_cast<const char*>(fileEntries.data()), static_cast<std::streamsize>(fileEntries.size() * sizeof(MeshCacheEntry)));
+            out.write(reinterpret_cast<const char*>(fileRefs.data()), static_cast<std::streamsize>(fileRefs.size() * sizeof(MeshCacheTextureRef)));
+            out.write(reinterpret_cast<const char*>(fileDependencies.data()), static_cast<std::streamsize>(fileDependencies.size() * sizeof(MeshCacheDependency)));
+            out.write(reinterpret_cast<const char*>(fileLods.data()), static_cast<std::streamsize>(fileLods.size() * sizeof(MeshLod)));
+            out.write(stringTable.data(), static_cast<std::streamsize>(stringTable.size()));
+            for (size_t i = 0; i < meshes.size(); i++)
+            {
+                pad(out, fileEntries[i].vertexOffset);
+                out.write(reinterpret_cast<const char*>(vertexStreams[i].data()), static_cast<std::streamsize>(vertexStreams[i].size()));
+                pad(out, fileEntries[i].indexOffset);
+                out.write(reinterpret_cast<const char*>(indexStreams[i].data()), static_cast<std::streamsize>(indexStreams[i].size()));
+            }
+            if (!out) return false;
+        }
+        // Rename last so a crash mid-write never leaves a truncated cache behind
+        std::filesystem::rename(tempPath, cachePath, ec);
+        return !ec;
+    }
+
+private:
+    FileData file;
+    const MeshCacheHeader* header = nullptr;
+    const MeshCacheEntry* entries = nullptr;
+    const MeshCacheTextureRef* textureRefs = nullptr;
+    const MeshCacheDependency* dependencies = nullptr;
+    const MeshLod* lods = nullptr;
+    const char* strings = nullptr;
+
+    bool reject()
+    {
+        file = FileData();
+        header = nullptr;
+        return false;
+    }
+
+    // Stores a new mtime at offset, the header's or a dependency's, once the content was found unchanged
+    static void refreshMtime(const std::string& cachePath, uint64_t offset, int64_t mtime)
+    {
+        std::fstream out(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+        out.seekp(static_cast<std::streamoff>(offset));
+        out.write(reinterpret_cast<const char*>(&mtime), sizeof(mtime));
+    }
+
+    static uint32_t appendString(std::string& table, const std::string& value, uint32_t& length)
+    {
+        const auto offset = static_cast<uint32_t>(table.size());
+        table += value;
+        length = static_cast<uint32_t>(value.size());
+        return offset;
+    }
+
+    static uint64_t align(uint64_t offset)
+    {
+        return (offset + 15) & ~static_cast<uint64_t>(15);
+    }
+
+    static void pad(std::ofstream& out, uint64_t offset)
+    {
+        static constexpr char zeros[16] = {};
+        const auto position = static_cast<uint64_t>(out.tellp());
+        out.write(zeros, static_cast<std::streamsize>(offset - position));
+    }
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "ImportSettings.h"
+
+#include <span>
+#include <string>
+#include <vector>
+using namespace std;
+
+#define MAX_BONE_INFLUENCE 4
+
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texCoords;
+};
+
+struct Texture {
+    GLuint id;
+    string type;
+    string path;
+};
+
+// Material texture reference, resolved to a GL texture on the context thread
+struct TextureRef {
+    string type;
+    string path;
+};
+
+// Index range of one level of detail inside a mesh's index buffer; level 0 is the full mesh
+struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error; // simplification error relative to the mesh bounds diagonal
+};
+
+// Non-owning view of GPU-ready mesh data, either freshly imported or mapped from the mesh cache.
+// Cached meshes come as StreamCodec streams instead of vertices and indices, see encoded().
+struct MeshView {
+    span<const Vertex> vertices;
+    span<const GLuint> indices;
+    span<const MeshLod> lods;
+    vector<TextureRef> textureRefs;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    VertexFormat format = VertexFormat::Float;
+    span<const uint8_t> encodedVertices;
+    span<const uint8_t> encodedIndices;
+    uint32_t encodedVertexCount = 0;
+    uint32_t encodedIndexCount = 0;
+
+    bool encoded() const { return !encodedVertices.empty(); }
+};
+
+// CPU-side result of importing one mesh, built without touching the GL context
+struct MeshData {
+    vector<Vertex> vertices;
+    vector<GLuint> indices;         // every level of detail, back to back
+    vector<MeshLod> lods;
+    vector<TextureRef> textureRefs;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    VertexFormat format = VertexFormat::Float; // GPU layout chosen at import, see VertexPacking::choose
+    glm::mat4 transform = glm::mat4(1.0f);     // node transform in the source scene; ModelImporter::import bakes it into the vertices
+
+    MeshView view() const
+    {
+        return { vertices, indices, lods, textureRefs, boundsMin, boundsMax, format };
+    }
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "MeshData.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Import-time merging of meshes that share a material. Importers split models into many small
+// pieces (one per object, group or node), and every piece costs a draw call with its own texture
+// binds. Pieces are grouped by their texture references, which is everything Mesh::draw binds,
+// and each group becomes one mesh. Pieces must already be in model space (ModelImporter bakes
+// node transforms before merging), so this only concatenates vertices and rebases indices.
+class MeshMerger
+{
+public:
+    // Merges in place; groups keep the order in which their first piece appeared
+    static void mergeByMaterial(std::vector<MeshData>& meshes)
+    {
+        std::unordered_map<std::string, size_t> groupByMaterial;
+        std::vector<MeshData> merged;
+        for (MeshData& mesh : meshes)
+        {
+            const auto [group, inserted] = groupByMaterial.try_emplace(materialKey(mesh.textureRefs), merged.size());
+            if (inserted)
+            {
+                merged.push_back(std::move(mesh));
+                continue;
+            }
+
+            MeshData& target = merged[group->second];
+            const auto baseVertex = static_cast<GLuint>(target.vertices.size());
+            target.vertices.insert(target.vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+            target.indices.reserve(target.indices.size() + mesh.indices.size());
+            for (GLuint index : mesh.indices)
+            {
+                target.indices.push_back(baseVertex + index);
+            }
+        }
+        meshes = std::move(merged);
+    }
+
+private:
+    static std::string materialKey(const std::vector<TextureRef>& refs)
+    {
+        std::string key;
+        for (const TextureRef& ref : refs)
+        {
+            key += ref.type;
+            key += '\n';
+            key += ref.path;
+            key += '\n';
+        }
+        return key;
+    }
+};
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+// Post-transform cache statistics of an index buffer, measured with a FIFO cache
+struct CacheStats
+{
+    float acmr = 0.0f; // average cache miss ratio: vertex shader runs per triangle (0.5 is ideal, 3 is worst)
+    float atvr = 0.0f; // average transform to vertex ratio: vertex shader runs per unique vertex (1 is ideal)
+};
+
+// Import-time reordering of triangle lists. Runs on the worker pool, so it must stay free of GL calls.
+//  1. Tipsify (Sander, Nehab, Barczak 2007) orders triangles for post-transform cache hits and
+//     yields clusters that start at cache flushes.
+//  2. Those clusters are sorted front-to-back by an occlusion potential that is independent
+//     of the view, which cuts overdraw without giving up the cache order inside each cluster.
+//  3. Vertices are renumbered in order of first use, so vertex fetch walks the VBO linearly.
+class MeshOptimizer
+{
+public:
+    static constexpr uint32_t CACHE_SIZE = 16;
+
+    static CacheStats analyze(const vector<GLuint>& indices, size_t vertexCount, uint32_t cacheSize = CACHE_SIZE)
+    {
+        CacheStats stats;
+        if (indices.empty() || vertexCount == 0) return stats;
+
+        // A vertex is cached while fewer than cacheSize misses happened since it was last loaded
+        std::vector<uint32_t> loadedAt(vertexCount, 0);
+        uint32_t misses = 0;
+        for (GLuint index : indices)
+        {
+            if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize)
+            {
+                misses++;
+                loadedAt[index] = misses;
+            }
+        }
+        stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+        stats.atvr = static_cast<float>(misses) / static_cast<float>(vertexCount);
+        return stats;
+    }
+
+    // Runs all three passes in place
+    static void optimize(MeshData& mesh, uint32_t cacheSize = CACHE_SIZE)
+    {
+        if (mesh.indices.size() < 3 || mesh.indices.size() % 3 != 0) return;
+
+        std::vector<uint32_t> clusters;
+        mesh.indices = tipsify(mesh.indices, mesh.vertices.size(), cacheSize, clusters);
+        mesh.indices = sortClusters(mesh.indices, mesh.vertices, clusters);
+        optimizeVertexFetch(mesh);
+    }
+
+    // Returns the reordered indices and the first triangle of every cluster in clusters
+    static vector<GLuint> tipsify(const vector<GLuint>& indices, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>& clusters)
+    {
+        const size_t triangleCount = indices.size() / 3;
+
+        // vertex -> triangle adjacency in compressed rows
+        std::vector<uint32_t> live(vertexCount, 0);
+        for (GLuint index : indices) live[index]++;
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + live[v];
+        std::vector<uint32_t> adjacency(indices.size());
+        {
+            std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++) adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> deadEnd;
+        std::vector<uint32_t> candidates;
+        vector<GLuint> output;
+        output.reserve(indices.size());
+        clusters.assign(1, 0);
+
+        uint32_t time = cacheSize + 1;
+        size_t cursor = 0;
+        int64_t fanning = 0;
+        while (fanning >= 0)
+        {
+            candidates.clear();
+            for (uint32_t a = offsets[fanning]; a < offsets[fanning + 1]; a++)
+            {
+                const uint32_t triangle = adjacency[a];
+                if (emitted[triangle]) continue;
+                for (int k = 0; k < 3; k++)
+                {
+                    const GLuint v = indices[triangle * 3 + k];
+                    output.push_back(v);
+                    deadEnd.push_back(v);
+                    candidates.push_back(v);
+                    live[v]--;
+                    if (time - cacheTime[v] > cacheSize)
+                    {
+                        cacheTime[v] = time++;
+                    }
+                }
+                emitted[triangle] = true;
+            }
+
+            // Next fanning vertex: the live candidate that stays in cache longest
+            int64_t best = -1;
+            int64_t bestPriority = -1;
+            for (uint32_t v : candidates)
+            {
+                if (live[v] == 0) continue;
+                int64_t priority = 0;
+                if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+                {
+                    priority = time - cacheTime[v];
+                }
+                if (priority > bestPriority)
+                {
+                    best = v;
+                    bestPriority = priority;
+                }
+            }
+
+            if (best == -1)
+            {
+                // Dead end: the cache no longer helps, so a new cluster starts here
+                while (!deadEnd.empty() && best == -1)
+                {
+                    const uint32_t v = deadEnd.back();
+                    deadEnd.pop_back();
+                    if (live[v] > 0) best = v;
+                }
+                while (best == -1 && cursor < vertexCount)
+                {
+                    if (live[cursor] > 0) best = static_cast<int64_t>(cursor);
+                    cursor++;
+                }
+                if (best != -1 && output.size() / 3 > clusters.back())
+                {
+                    clusters.push_back(static_cast<uint32_t>(output.size() / 3));
+                }
+            }
+            fanning = best;
+        }
+        return output;
+    }
+
+    // Orders clusters so the ones facing away from the mesh center, which tend to occlude the rest, draw first
+    static vector<GLuint> sortClusters(const vector<GLuint>& indices, const vector<Vertex>& vertices, const std::vector<uint32_t>& clusters)
+    {
+        const auto triangleCount = static_cast<uint32_t>(indices.size() / 3);
+        if (clusters.size() < 2) return indices;
+
+        glm::vec3 meshCenter(0.0f);
+        float meshArea = 0.0f;
+        std::vector<glm::vec3> clusterCenter(clusters.size(), glm::vec3(0.0f));
+        std::vector<glm::vec3> clusterNormal(clusters.size(), glm::vec3(0.0f));
+        std::vector<float> clusterArea(clusters.size(), 0.0f);
+        for (size_t c = 0; c < clusters.size(); c++)
+        {
+            const uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+            for (uint32_t t = clusters[c]; t < end; t++)
+            {
+                const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+                const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+                const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+                const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0); // length is twice the area
+                const float area = glm::length(normal);
+                const glm::vec3 center = (p0 + p1 + p2) / 3.0f;
+                clusterCenter[c] += center * area;
+                clusterNormal[c] += normal;
+                clusterArea[c] += area;
+            }
+            meshCenter += clusterCenter[c];
+            meshArea += clusterArea[c];
+        }
+        if (meshArea > 0.0f) meshCenter /= meshArea;
+
+        std::vector<float> sortKey(clusters.size(), 0.0f);
+        for (size_t c = 0; c < clusters.size(); c++)
+        {
+            if (clusterArea[c] <= 0.0f) continue;
+            const glm::vec3 center = clusterCenter[c] / clusterArea[c];
+            const float normalLength = glm::length(clusterNormal[c]);
+            if (normalLength > 0.0f)
+            {
+                sortKey[c] = glm::dot(center - meshCenter, clusterNormal[c] / normalLength);
+            }
+        }
+
+        std::vector<uint32_t> order(clusters.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+        vector<GLuint> output;
+        output.reserve(indices.size());
+        for (uint32_t c : order)
+        {
+            const uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+            output.insert(output.end(), indices.begin() + clusters[c] * 3, indices.begin() + end * 3);
+        }
+        return output;
+    }
+
+    // Renumbers vertices in order of first reference and drops unreferenced ones
+    static void optimizeVertexFetch(MeshData& mesh)
+    {
+        constexpr GLuint unused = ~0u;
+        std::vector<GLuint> remap(mesh.vertices.size(), unused);
+        vector<Vertex> vertices;
+        vertices.reserve(mesh.vertices.size());
+        for (GLuint& index : mesh.indices)
+        {
+            if (remap[index] == unused)
+            {
+                remap[index] = static_cast<GLuint>(vertices.size());
+                vertices.push_back(mesh.vertices[index]);
+            }
+            index = remap[index];
+        }
+        mesh.vertices = std::move(vertices);
+    }
+};
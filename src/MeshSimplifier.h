@@ -0,0 +1,330 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "MeshData.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Quadric error metric simplification (Garland & Heckbert 1997) restricted to half-edge collapses,
+// so every level of detail is just another index list over the original vertex buffer.
+// Vertices are grouped by position first, which lets unwelded imports collapse as one surface.
+// Groups whose members disagree on normal or UV (attribute seams) and open borders never move.
+class MeshSimplifier
+{
+public:
+    // Appends up to levelCount coarser index lists to mesh.indices, each about `reduction` times the
+    // triangles of the previous one, and records their ranges in mesh.lods
+    static void buildLods(MeshData& mesh, int levelCount, float reduction)
+    {
+        if (mesh.lods.empty()) mesh.lods.push_back({ 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f });
+        const MeshLod base = mesh.lods.front();
+        if (base.indexCount % 3 != 0) return;
+
+        std::vector<GLuint> previous(mesh.indices.begin() + base.firstIndex, mesh.indices.begin() + base.firstIndex + base.indexCount);
+        for (int level = 1; level <= levelCount; level++)
+        {
+            const auto target = static_cast<size_t>(static_cast<float>(previous.size() / 3) * reduction) * 3;
+            if (target < 3) break;
+
+            float error = 0.0f;
+            std::vector<GLuint> simplified = simplify(mesh.vertices, previous, target, error);
+
+            // Not worth a level when the simplifier is stuck on locked seams and borders
+            if (simplified.empty() || simplified.size() > previous.size() * 9 / 10) break;
+
+            std::vector<uint32_t> clusters;
+            simplified = MeshOptimizer::tipsify(simplified, mesh.vertices.size(), MeshOptimizer::CACHE_SIZE, clusters);
+
+            mesh.lods.push_back({ static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(simplified.size()), error });
+            mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+            previous = std::move(simplified);
+        }
+    }
+
+    // Returns at most targetIndexCount indices when the mesh allows it. error receives the largest
+    // collapse error, relative to the mesh bounds diagonal.
+    static std::vector<GLuint> simplify(const std::vector<Vertex>& vertices, std::span<const GLuint> indices, size_t targetIndexCount, float& error)
+    {
+        error = 0.0f;
+        const size_t vertexCount = vertices.size();
+
+        // Group vertices sharing a position; seams are groups whose members differ in other attributes
+        std::vector<uint32_t> group(vertexCount);
+        std::vector<uint32_t> representative;
+        std::vector<bool> locked;
+        {
+            std::unordered_map<uint64_t, uint32_t> byPosition;
+            for (size_t v = 0; v < vertexCount; v++)
+            {
+                const auto [it, inserted] = byPosition.try_emplace(positionKey(vertices[v].position), static_cast<uint32_t>(representative.size()));
+                if (inserted)
+                {
+                    representative.push_back(static_cast<uint32_t>(v));
+                    locked.push_back(false);
+                }
+                else
+                {
+                    const Vertex& first = vertices[representative[it->second]];
+                    if (!(first.normal == vertices[v].normal) || !(first.texCoords == vertices[v].texCoords)) locked[it->second] = true;
+                }
+                group[v] = it->second;
+            }
+        }
+        const size_t groupCount = representative.size();
+        auto position = [&](uint32_t g) -> const glm::vec3& { return vertices[representative[g]].position; };
+
+        std::vector<GLuint> triangles(indices.begin(), indices.end());
+        removeDegenerate(triangles, group);
+
+        // Borders and non-manifold edges (edges without exactly two triangles) keep both ends in place
+        {
+            std::unordered_map<uint64_t, uint32_t> edgeUse;
+            forEachEdge(triangles, group, [&](uint32_t a, uint32_t b) { edgeUse[edgeKey(a, b)]++; });
+            for (const auto& [key, count] : edgeUse)
+            {
+                if (count != 2)
+                {
+                    locked[static_cast<uint32_t>(key >> 32)] = true;
+                    locked[static_cast<uint32_t>(key)] = true;
+                }
+            }
+        }
+
+        std::vector<Quadric> quadrics(groupCount);
+        for (size_t t = 0; t < triangles.size(); t += 3)
+        {
+            const uint32_t g0 = group[triangles[t]], g1 = group[triangles[t + 1]], g2 = group[triangles[t + 2]];
+            const Quadric plane = Quadric::fromTriangle(position(g0), position(g1), position(g2));
+            quadrics[g0] += plane;
+            quadrics[g1] += plane;
+            quadrics[g2] += plane;
+        }
+
+        // Per group collapsed in the current pass, the vertex its corners move to
+        std::vector<GLuint> collapseTo(groupCount, NO_COLLAPSE);
+
+        double maxCost = 0.0;
+        std::vector<Collapse> collapses;
+        std::vector<bool> touched(groupCount);
+        std::vector<uint32_t> offsets, adjacency;
+        while (triangles.size() > targetIndexCount)
+        {
+            buildAdjacency(triangles, group, groupCount, offsets, adjacency);
+
+            // Cheapest direction of every edge
+            collapses.clear();
+            forEachEdge(triangles, group, [&](uint32_t a, uint32_t b)
+            {
+                if (a > b) return; // every interior edge shows up once per direction
+                Collapse best{ 0, 0, -1.0 };
+                if (!locked[a]) best = { a, b, (quadrics[a] + quadrics[b]).evaluate(position(b)) };
+                if (!locked[b])
+                {
+                    const double cost = (quadrics[a] + quadrics[b]).evaluate(position(a));
+                    if (best.cost < 0.0 || cost < best.cost) best = { b, a, cost };
+                }
+                if (best.cost >= 0.0) collapses.push_back(best);
+            });
+            if (collapses.empty()) break;
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+            // Apply independent collapses, cheapest first, until this pass reaches the target
+            std::fill(touched.begin(), touched.end(), false);
+            size_t remaining = triangles.size() / 3;
+            size_t applied = 0;
+            for (const Collapse& collapse : collapses)
+            {
+                if (remaining * 3 <= targetIndexCount) break;
+                if (touched[collapse.from] || touched[collapse.to]) continue;
+                if (flips(collapse, triangles, group, offsets, adjacency, position)) continue;
+
+                size_t removed = 0;
+                GLuint target = NO_COLLAPSE;
+                for (uint32_t a = offsets[collapse.from]; a < offsets[collapse.from + 1]; a++)
+                {
+                    const size_t t = adjacency[a] * 3;
+                    for (int k = 0; k < 3; k++)
+                    {
+                        touched[group[triangles[t + k]]] = true;
+                        if (group[triangles[t + k]] != collapse.to) continue;
+                        target = triangles[t + k];
+                        removed++;
+                    }
+                }
+                collapseTo[collapse.from] = target;
+                quadrics[collapse.to] += quadrics[collapse.from];
+                maxCost = std::max(maxCost, collapse.cost);
+                remaining -= removed;
+                applied++;
+            }
+            if (applied == 0) break;
+
+            // A collapsed corner takes over the vertex the triangles on the collapsed edge use. The source
+            // group is never a seam, so its whole fan lies on one side of any seam through the target, and
+            // that vertex carries the normal and UV of this side rather than those of the representative.
+            for (GLuint& index : triangles)
+            {
+                const GLuint target = collapseTo[group[index]];
+                if (target != NO_COLLAPSE) index = target;
+            }
+            std::fill(collapseTo.begin(), collapseTo.end(), NO_COLLAPSE);
+            removeDegenerate(triangles, group);
+        }
+
+        glm::vec3 boundsMin(0.0f), boundsMax(0.0f);
+        if (vertexCount > 0)
+        {
+            boundsMin = boundsMax = vertices[0].position;
+            for (const Vertex& vertex : vertices)
+            {
+                boundsMin = glm::min(boundsMin, vertex.position);
+                boundsMax = glm::max(boundsMax, vertex.position);
+            }
+        }
+        const float diagonal = glm::length(boundsMax - boundsMin);
+        error = diagonal > 0.0f ? static_cast<float>(std::sqrt(maxCost)) / diagonal : 0.0f;
+        return triangles;
+    }
+
+private:
+    static constexpr GLuint NO_COLLAPSE = UINT32_MAX;
+
+    // Symmetric 4x4 matrix of summed squared plane distances
+    struct Quadric
+    {
+        double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+        static Quadric fromTriangle(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+        {
+            const glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+            const double length = glm::length(cross);
+            Quadric q;
+            if (length <= 0.0) return q;
+
+            // Weighted by area so dense regions do not dominate
+            const double area = length * 0.5;
+            const double a = cross.x / length, b = cross.y / length, c = cross.z / length;
+            const double d = -(a * p0.x + b * p0.y + c * p0.z);
+            q.a2 = a * a * area; q.ab = a * b * area; q.ac = a * c * area; q.ad = a * d * area;
+            q.b2 = b * b * area; q.bc = b * c * area; q.bd = b * d * area;
+            q.c2 = c * c * area; q.cd = c * d * area;
+            q.d2 = d * d * area;
+            return q;
+        }
+
+        Quadric& operator+=(const Quadric& o)
+        {
+            a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+            b2 += o.b2; bc += o.bc; bd += o.bd;
+            c2 += o.c2; cd += o.cd;
+            d2 += o.d2;
+            return *this;
+        }
+
+        Quadric operator+(const Quadric& o) const
+        {
+            Quadric sum = *this;
+            return sum += o;
+        }
+
+        double evaluate(const glm::vec3& p) const
+        {
+            const double x = p.x, y = p.y, z = p.z;
+            const double error = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                + c2 * z * z + 2 * cd * z
+                + d2;
+            return std::max(error, 0.0);
+        }
+    };
+
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+
+    static uint64_t positionKey(const glm::vec3& position)
+    {
+        uint32_t bits[3];
+        std::memcpy(bits, &position[0], sizeof(bits));
+        uint64_t key = bits[0];
+        key = key * 0x9E3779B97F4A7C15ull ^ bits[1];
+        key = key * 0x9E3779B97F4A7C15ull ^ bits[2];
+        // Colliding keys only merge groups, which at worst locks them as seams
+        return key;
+    }
+
+    static uint64_t edgeKey(uint32_t a, uint32_t b)
+    {
+        return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+    }
+
+    template <class F>
+    static void forEachEdge(const std::vector<GLuint>& triangles, const std::vector<uint32_t>& group, F&& function)
+    {
+        for (size_t t = 0; t < triangles.size(); t += 3)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                function(group[triangles[t + k]], group[triangles[t + (k + 1) % 3]]);
+            }
+        }
+    }
+
+    static void removeDegenerate(std::vector<GLuint>& triangles, const std::vector<uint32_t>& group)
+    {
+        size_t write = 0;
+        for (size_t t = 0; t < triangles.size(); t += 3)
+        {
+            const uint32_t g0 = group[triangles[t]], g1 = group[triangles[t + 1]], g2 = group[triangles[t + 2]];
+            if (g0 == g1 || g1 == g2 || g0 == g2) continue;
+            triangles[write++] = triangles[t];
+            triangles[write++] = triangles[t + 1];
+            triangles[write++] = triangles[t + 2];
+        }
+        triangles.resize(write);
+    }
+
+    static void buildAdjacency(const std::vector<GLuint>& triangles, const std::vector<uint32_t>& group, size_t groupCount,
+        std::vector<uint32_t>& offsets, std::vector<uint32_t>& adjacency)
+    {
+        offsets.assign(groupCount + 1, 0);
+        for (GLuint index : triangles) offsets[group[index] + 1]++;
+        for (size_t g = 0; g < groupCount; g++) offsets[g + 1] += offsets[g];
+        adjacency.resize(triangles.size());
+        std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < triangles.size(); i++) adjacency[cursor[group[triangles[i]]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    // True when moving collapse.from onto collapse.to would turn any surviving triangle around it inside out
+    template <class P>
+    static bool flips(const Collapse& collapse, const std::vector<GLuint>& triangles, const std::vector<uint32_t>& group,
+        const std::vector<uint32_t>& offsets, const std::vector<uint32_t>& adjacency, P&& position)
+    {
+        for (uint32_t a = offsets[collapse.from]; a < offsets[collapse.from + 1]; a++)
+        {
+            const size_t t = adjacency[a] * 3;
+            uint32_t g[3] = { group[triangles[t]], group[triangles[t + 1]], group[triangles[t + 2]] };
+            if (g[0] == collapse.to || g[1] == collapse.to || g[2] == collapse.to) continue;
+
+            const glm::vec3 before = glm::cross(position(g[1]) - position(g[0]), position(g[2]) - position(g[0]));
+            for (uint32_t& corner : g)
+            {
+                if (corner == collapse.from) corner = collapse.to;
+            }
+            const glm::vec3 after = glm::cross(position(g[1]) - position(g[0]), position(g[2]) - position(g[0]));
+            if (glm::dot(before, after) <= 0.0f) return true;
+        }
+        return false;
+    }
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "MeshData.h"
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Import-time vertex welding. Importers that emit one vertex per face corner leave identical
+// vertices unshared, which inflates the VBO and defeats the post-transform cache.
+// Vertices are bucketed in a hash grid over their positions; a vertex merges into the first
+// earlier one whose position, normal and UV all lie within the tolerances (per component).
+class MeshWelder
+{
+public:
+    struct Stats
+    {
+        size_t verticesBefore = 0;
+        size_t verticesAfter = 0;
+    };
+
+    // Merges matching vertices in place and rewrites the indices. Tolerances are absolute; with all of them
+    // at zero only bit-identical vertices merge. The surviving vertices keep their relative order.
+    static Stats weld(MeshData& mesh, float positionEpsilon, float normalEpsilon, float texCoordEpsilon)
+    {
+        Stats stats;
+        stats.verticesBefore = stats.verticesAfter = mesh.vertices.size();
+        if (mesh.vertices.empty()) return stats;
+
+        // Cells at least twice the tolerance wide: a match is either in the vertex's own cell or across
+        // the nearer boundary on each axis, so 8 cells cover every candidate
+        const float cellSize = positionEpsilon > 0.0f ? 2.0f * positionEpsilon : 1.0f;
+        const float inverseCell = 1.0f / cellSize;
+
+        constexpr uint32_t none = ~0u;
+        std::unordered_map<uint64_t, uint32_t> cells;      // cell -> last welded vertex in it
+        std::vector<uint32_t> next;                        // welded vertex -> previous one in its cell
+        cells.reserve(mesh.vertices.size());
+        next.reserve(mesh.vertices.size());
+
+        vector<Vertex> welded;
+        welded.reserve(mesh.vertices.size());
+        std::vector<GLuint> remap(mesh.vertices.size());
+
+        for (size_t i = 0; i < mesh.vertices.size(); i++)
+        {
+            const Vertex& vertex = mesh.vertices[i];
+            const glm::vec3 scaled = vertex.position * inverseCell;
+            const glm::vec3 base = glm::floor(scaled);
+            const glm::ivec3 cell(base);
+            const glm::ivec3 side(
+                scaled.x - base.x < 0.5f ? -1 : 1,
+                scaled.y - base.y < 0.5f ? -1 : 1,
+                scaled.z - base.z < 0.5f ? -1 : 1);
+
+            uint32_t match = none;
+            for (int corner = 0; corner < 8 && match == none; corner++)
+            {
+                const glm::ivec3 probe = cell + glm::ivec3(corner & 1 ? side.x : 0, corner & 2 ? side.y : 0, corner & 4 ? side.z : 0);
+                const auto found = cells.find(cellKey(probe));
+                if (found == cells.end()) continue;
+                for (uint32_t candidate = found->second; candidate != none; candidate = next[candidate])
+                {
+                    if (matches(welded[candidate], vertex, positionEpsilon, normalEpsilon, texCoordEpsilon))
+                    {
+                        match = candidate;
+                        break;
+                    }
+                }
+            }
+
+            if (match == none)
+            {
+                match = static_cast<uint32_t>(welded.size());
+                welded.push_back(vertex);
+                auto [slot, inserted] = cells.try_emplace(cellKey(cell), match);
+                next.push_back(inserted ? none : slot->second);
+                slot->second = match;
+            }
+            remap[i] = match;
+        }
+
+        for (GLuint& index : mesh.indices) index = remap[index];
+        mesh.vertices = std::move(welded);
+        stats.verticesAfter = mesh.vertices.size();
+        return stats;
+    }
+
+private:
+    // 21 bits per axis; cells that alias after wrapping only cost an extra comparison
+    static uint64_t cellKey(const glm::ivec3& cell)
+    {
+        constexpr uint64_t mask = (1u << 21) - 1;
+        return (static_cast<uint64_t>(cell.x) & mask) | (static_cast<uint64_t>(cell.y) & mask) << 21 | (static_cast<uint64_t>(cell.z) & mask) << 42;
+    }
+
+    static bool matches(const Vertex& a, const Vertex& b, float positionEpsilon, float normalEpsilon, float texCoordEpsilon)
+    {
+        const glm::vec3 position = glm::abs(a.position - b.position);
+        const glm::vec3 normal = glm::abs(a.normal - b.normal);
+        const glm::vec2 texCoords = glm::abs(a.texCoords - b.texCoords);
+        return position.x <= positionEpsilon && position.y <= positionEpsilon && position.z <= positionEpsilon &&
+            normal.x <= normalEpsilon && normal.y <= normalEpsilon && normal.z <= normalEpsilon &&
+            texCoords.x <= texCoordEpsilon && texCoords.y <= texCoordEpsilon;
+    }
+};
@@ -2,209 +2,336 @@
 #include <glad/glad.h> 
 #include <glm/glm.hpp>
 #include <stb_image.h>
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
 
+#include <algorithm>
+#include <memory>
+
+#include "AssetWatcher.h"
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "ModelImporter.h"
+#include "ResidencyManager.h"
 #include "SceneObject.h"
 #include "Shader.h"
+#include "TextureCache.h"
+#include "TextureLoader.h"
 
 GLuint textureFromFile(const char* path, const string& directory, bool gamma = false);
 
-class Model : public SceneObject
+// Registered with the ResidencyManager: under memory pressure the meshes and texture references
+// are dropped. The next draw maps them back from the mesh cache when the model was cooked, and
+// otherwise starts a background re-import and draws nothing until it lands. Edits to the model's
+// source files are re-imported in the background the same way, through AssetWatcher.
+class Model : public SceneObject, public Resident
 {
 public:
-    vector<Texture> loadedTextures;
     vector<Mesh> meshes;
+    string path;
     string directory;
     bool gammaCorrection;
+    ImportSettings settings;
+    bool keepCpuData; // keeps Mesh::vertices and indices filled, for models queried on the CPU
 
-    Model(string const& path, const bool gamma = false)
+    Model(string const& path, const bool gamma = false, const ImportSettings& settings = ImportSettings(), const bool keepCpuData = false)
     {
         gammaCorrection = gamma;
+        this->settings = settings;
+        this->keepCpuData = keepCpuData;
+        this->path = path;
         loadModel(path);
+        ResidencyManager::instance().add(this);
     }
 
-    void draw(const Shader &shader) const override
+    // Textures are shared through TextureCache, so a copy would release them twice
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+
+    ~Model() override
     {
-        for (const Mesh &mesh : meshes)
+        ResidencyManager::instance().remove(this);
+        for (uint64_t watch : watches)
         {
-            mesh.draw(shader);
+            AssetWatcher::instance().unsubscribe(watch);
         }
+        releaseTextures();
     }
 
-private:
-    void loadModel(string const& path)
+    void draw(const Shader &shader, const DrawUniforms& uniforms) const override
     {
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+        draw(shader, uniforms, 0);
+    }
 
-        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    // Meshes of one vertex format share an arena, so its VAO is only bound when the format changes
+    void draw(const Shader& shader, const DrawUniforms& uniforms, int lod) const override
+    {
+        if (!makeResident()) return;
+        const GeometryArena* bound = nullptr;
+        for (const Mesh& mesh : meshes)
         {
-            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
+            if (&mesh.geometry.arena() != bound)
+            {
+                bound = &mesh.geometry.arena();
+                bound->bind();
+            }
+            mesh.draw(shader, uniforms, lod);
         }
+        glBindVertexArray(0);
+    }
 
-        directory = path.substr(0, path.find_last_of('/'));
-        processNode(scene->mRootNode, scene);
+    // Level count and bounds are kept from the last load, so LOD selection works on evicted models too
+    int lodCount() const override
+    {
+        return lodLevels;
     }
 
-    void processNode(aiNode* node, const aiScene* scene)
+    bool bounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const override
     {
-        for (GLuint i = 0; i < node->mNumMeshes; i++)
+        if (!hasBounds) return false;
+        boundsMin = this->boundsMin;
+        boundsMax = this->boundsMax;
+        return true;
+    }
+
+    bool isResident() const override
+    {
+        return resident;
+    }
+
+    size_t gpuBytes() const override
+    {
+        size_t bytes = 0;
+        for (const Mesh& mesh : meshes)
         {
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            const GeometryRange& range = mesh.geometry.range();
+            bytes += range.vertexCount * VertexPacking::stride(mesh.format) + range.indexCount * sizeof(GLuint);
         }
-        for (GLuint i = 0; i < node->mNumChildren; i++)
+        return bytes;
+    }
+
+    size_t cpuBytes() const override
+    {
+        size_t bytes = meshes.capacity() * sizeof(Mesh);
+        for (const Mesh& mesh : meshes)
         {
-            processNode(node->mChildren[i], scene);
+            bytes += mesh.vertices.capacity() * sizeof(Vertex) + mesh.indices.capacity() * sizeof(GLuint) +
+                mesh.lods.capacity() * sizeof(MeshLod) + mesh.textures.capacity() * sizeof(Texture);
         }
+        return bytes;
     }
 
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene)
+    void evict() override
     {
-        std::vector<Vertex> vertices;
-        std::vector<unsigned int> indices;
-        std::vector<Texture> textures;
+        releaseTextures();
+        vector<Mesh>().swap(meshes);
+        resident = false;
+    }
 
-        for (GLuint i = 0; i < mesh->mNumVertices; i++)
+private:
+    bool resident = false;
+    int lodLevels = 1;
+    bool hasBounds = false;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+
+    struct Reimport
+    {
+        vector<MeshData> meshes;
+        vector<string> dependencies;
+        bool succeeded = false;
+    };
+
+    vector<uint64_t> watches;
+    uint64_t reloadGeneration = 0;
+    bool reloadPending = false; // the latest reload has not landed yet
+    uint64_t textureMerges = 0; // TextureCache::merges() when the texture names were last resolved
+    std::shared_ptr<bool> lifetime = std::make_shared<bool>(true); // lets posted reloads detect a destroyed model
+
+    // Imports off the GL thread; the new meshes replace the old ones at the next frame boundary.
+    // Only the latest of overlapping reloads is applied, and a failed one keeps the old meshes.
+    void reload()
+    {
+        const uint64_t generation = ++reloadGeneration;
+        reloadPending = true;
+        ThreadPool::shared().submit([this, token = std::weak_ptr<bool>(lifetime), generation, path = path, settings = settings]
         {
-            Vertex vertex;
-            glm::vec3 vector;
-
-            //vertex position
-            vector.x = mesh->mVertices[i].x;
-            vector.y = mesh->mVertices[i].y;
-            vector.z = mesh->mVertices[i].z;
-            vertex.position = vector;
-
-            //vertex normals
-            vector.x = mesh->mNormals[i].x;
-            vector.y = mesh->mNormals[i].y;
-            vector.z = mesh->mNormals[i].z;
-            vertex.normal = vector;
-
-            if (mesh->mTextureCoords[0]) //texture coords (if exist)
+            auto result = std::make_shared<Reimport>();
+            result->succeeded = ModelImporter::import(path, settings, result->meshes, &result->dependencies);
+            if (result->succeeded && !MeshCache::write(path, settings.key(ModelImporter::IMPORT_FLAGS), result->meshes, result->dependencies))
             {
-                glm::vec2 vec;
-                vec.x = mesh->mTextureCoords[0][i].x;
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.texCoords = vec;
-            }
-            else
-            {
-                vertex.texCoords = glm::vec2(0.0f, 0.0f);
+                cout << "ERROR::MESH_CACHE:: Failed to write cache for " << path << endl;
             }
 
-            vertices.push_back(vertex);
-        }
+            AssetWatcher::instance().post([this, token, generation, result, path]
+            {
+                if (token.expired() || generation != reloadGeneration) return;
+                reloadPending = false;
+                if (!result->succeeded)
+                {
+                    // An evicted model stays empty rather than retrying every frame; the next edit retries
+                    resident = true;
+                    return;
+                }
+                releaseTextures();
+                meshes.clear();
+                for (MeshData& data : result->meshes)
+                {
+                    createMesh(data.view());
+                    data = MeshData();
+                }
+                updateSummary();
+                resident = true;
+                watchSources(result->dependencies);
+                spdlog::info("Hot reload: {} re-imported", path);
+            });
+        });
+    }
 
-        // indices
-        for (GLuint i = 0; i < mesh->mNumFaces; i++)
+    // The model file is always watched; the files it pulls in (.mtl, ...) are known after an import or from the mesh cache
+    void watchSources(const vector<string>& dependencies)
+    {
+        for (uint64_t watch : watches)
         {
-            aiFace face = mesh->mFaces[i];
-            for (GLuint k = 0; k < face.mNumIndices; k++)
-            {
-                indices.push_back(face.mIndices[k]);
-            }
+            AssetWatcher::instance().unsubscribe(watch);
         }
+        watches.clear();
 
-        // materials
-        if (mesh->mMaterialIndex >= 0)
+        vector<string> files = dependencies;
+        if (std::find(files.begin(), files.end(), path) == files.end()) files.push_back(path);
+        for (const string& file : files)
         {
-            aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-            std::vector<Texture> diffuseMaps = loadMaterialTextures(material,
-                aiTextureType_DIFFUSE, "texture_diffuse");
-            textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-            std::vector<Texture> specularMaps = loadMaterialTextures(material,
-                aiTextureType_SPECULAR, "texture_specular");
-            textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+            watches.push_back(AssetWatcher::instance().subscribe(file, [this] { reload(); }));
         }
-
-        return { vertices, indices, textures };
     }
 
-    vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName)
+    // Draws are const, but residency is bookkeeping rather than model state. Only a cooked model
+    // comes back within the draw; anything else would mean a full import on the GL thread.
+    bool makeResident() const
     {
-        std::vector<Texture> textures;
-        for (GLuint i = 0; i < mat->GetTextureCount(type); i++)
+        auto* self = const_cast<Model*>(this);
+        ResidencyManager::instance().touch(self);
+        if (!resident)
         {
-            aiString str;
-            mat->GetTexture(type, i, &str);
-            bool skip = false;
-            for (GLuint k = 0; k < loadedTextures.size(); k++)
+            if (reloadPending) return false;
+            if (!self->loadFromCache())
             {
-                if (std::strcmp(loadedTextures[k].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(loadedTextures[k]);
-                    skip = true;
-                    break;
-                }
+                self->reload();
+                return false;
             }
-            if (!skip)
+        }
+        self->followTextureMerges();
+        return true;
+    }
+
+    // TextureCache may find that two of its textures hold the same image only after handing both out
+    void followTextureMerges()
+    {
+        TextureCache& cache = TextureCache::instance();
+        if (textureMerges == cache.merges()) return;
+        textureMerges = cache.merges();
+        for (Mesh& mesh : meshes)
+        {
+            for (Texture& texture : mesh.textures)
             {
-                Texture texture;
-                texture.id = textureFromFile(str.C_Str(), directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                loadedTextures.push_back(texture);
+                texture.id = cache.resolve(texture.id);
             }
         }
-        return textures;
     }
-};
 
-inline GLuint textureFromFile(const char* path, const string& directory, bool gamma)
-{
-    string filename = string(path);
-    filename = directory + '/' + filename;
+    // Cooked meshes are mapped and uploaded as they are, without going through Assimp
+    bool loadFromCache()
+    {
+        MeshCache cache;
+        if (!cache.open(path, settings.key(ModelImporter::IMPORT_FLAGS))) return false;
 
-    GLuint textureID;
-    glGenTextures(1, &textureID);
+        for (size_t i = 0; i < cache.meshCount(); i++)
+        {
+            createMesh(cache.mesh(i));
+        }
+        updateSummary();
+        resident = true;
+        watchSources(cache.dependencyPaths());
+        return true;
+    }
 
-    int width, height, nrComponents;
-    if (unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0))
+    void loadModel(string const& path)
     {
-        GLenum format = 0;
-        switch (nrComponents)
-        {
-        case 1:
+        directory = path.substr(0, path.find_last_of('/'));
+        if (loadFromCache()) return;
+        resident = true;
+
+        const uint64_t importKey = settings.key(ModelImporter::IMPORT_FLAGS);
+
+        vector<MeshData> meshData;
+        vector<string> dependencies;
+        const bool imported = ModelImporter::import(path, settings, meshData, &dependencies);
+        watchSources(dependencies);
+        if (!imported) return;
+
+        if (!MeshCache::write(path, importKey, meshData, dependencies))
         {
-            format = GL_RED;
-            break;
+            cout << "ERROR::MESH_CACHE:: Failed to write cache for " << path << endl;
         }
-        case 3:
+
+        // Each import is released as soon as it is on the GPU, which keeps the peak near one copy of the model
+        for (MeshData& data : meshData)
         {
-            format = GL_RGB;
-            break;
+            createMesh(data.view());
+            data = MeshData();
         }
-        case 4:
+        updateSummary();
+    }
+
+    void updateSummary()
+    {
+        lodLevels = 1;
+        hasBounds = !meshes.empty();
+        if (!hasBounds) return;
+        boundsMin = meshes[0].boundsMin;
+        boundsMax = meshes[0].boundsMax;
+        for (const Mesh& mesh : meshes)
         {
-            format = GL_RGBA;
-            break;
-        }
-        default: break;
+            lodLevels = std::max(lodLevels, static_cast<int>(mesh.lods.size()));
+            boundsMin = glm::min(boundsMin, mesh.boundsMin);
+            boundsMax = glm::max(boundsMax, mesh.boundsMax);
         }
+    }
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(format), width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    void releaseTextures()
+    {
+        for (const Mesh& mesh : meshes)
+        {
+            for (const Texture& texture : mesh.textures)
+            {
+                TextureCache::instance().release(texture.id);
+            }
+        }
+    }
 
-        stbi_image_free(data);
+    void createMesh(const MeshView& view)
+    {
+        meshes.emplace_back(view, loadMaterialTextures(view.textureRefs), keepCpuData);
     }
-    else
+
+    vector<Texture> loadMaterialTextures(const vector<TextureRef>& refs) const
     {
-        std::cout << "Failed to load texture!\nat path: " << path << std::endl;
-        stbi_image_free(data);
+        std::vector<Texture> textures;
+        for (const TextureRef& ref : refs)
+        {
+            Texture texture;
+            texture.id = TextureCache::instance().acquire(directory + '/' + ref.path, gammaCorrection);
+            texture.type = ref.type;
+            texture.path = ref.path;
+            textures.push_back(texture);
+        }
+        return textures;
     }
+};
+
+// Returns immediately; the image is decoded in the background and streamed in by TextureLoader::update
+inline GLuint textureFromFile(const char* path, const string& directory, bool gamma)
+{
+    string filename = string(path);
+    filename = directory + '/' + filename;
 
-    return textureID;
+    return TextureLoader::instance().load(filename, gamma);
 }
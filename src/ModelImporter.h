@@ -0,0 +1,292 @@
+#pragma once
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <spdlog/spdlog.h>
+
+#include "ImportSettings.h"
+#include "MappedIOSystem.h"
+#include "MeshData.h"
+#include "MeshOptimizer.h"
+#include "MeshMerger.h"
+#include "MeshSimplifier.h"
+#include "MeshWelder.h"
+#include "ObjImporter.h"
+#include "ThreadPool.h"
+#include "VertexPacking.h"
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Source model -> runtime-ready MeshData, shared by Model and the offline cooker.
+// OBJ files go through the dedicated ObjImporter when it supports them, everything else through Assimp.
+// Nothing in here touches GL, so it runs on any thread and without a context.
+class ModelImporter
+{
+public:
+    // Assimp post-processing used for every import; also keys the mesh cache
+    static constexpr unsigned IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_FlipUVs;
+
+    static bool isModelFile(const std::string& path)
+    {
+        const size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos) return false;
+        Assimp::Importer importer;
+        return importer.IsExtensionSupported(path.substr(dot));
+    }
+
+    // Runtime switch for how Assimp reads files: memory mapped (the default) or its own stdio streams.
+    // Only speed differs, so it is not part of the cache key.
+    static void setMappedIO(bool enabled) { mappedIOEnabled() = enabled; }
+    static bool mappedIO() { return mappedIOEnabled(); }
+
+    enum class Parser
+    {
+        Auto,   // ObjImporter for .obj files, Assimp for everything else and as fallback
+        Assimp
+    };
+
+    // Imports, welds, optimizes and packs every mesh of the scene in node traversal order.
+    // dependencies, when given, receives every file that was read (the model itself, .mtl files, ...).
+    static bool import(const std::string& path, const ImportSettings& settings, std::vector<MeshData>& meshes, std::vector<std::string>* dependencies = nullptr)
+    {
+        if (!load(path, meshes, dependencies)) return false;
+
+        // Mesh and the cache only know model space, so node transforms go into the vertices here
+        for (MeshData& mesh : meshes) bakeTransform(mesh);
+
+        if (settings.mergeByMaterial)
+        {
+            const size_t drawCalls = meshes.size();
+            MeshMerger::mergeByMaterial(meshes);
+            spdlog::info("{}: merged by material, {} -> {} draw calls per instance", path, drawCalls, meshes.size());
+        }
+
+        std::vector<CacheStats> statsBefore(meshes.size()), statsAfter(meshes.size());
+        ThreadPool::shared().parallelFor(meshes.size(), [&](size_t i)
+        {
+            MeshData& mesh = meshes[i];
+            computeBounds(mesh);
+            mesh.lods = { { 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f } };
+            statsBefore[i] = MeshOptimizer::analyze(mesh.indices, mesh.vertices.size());
+
+            const float diagonal = glm::length(mesh.boundsMax - mesh.boundsMin);
+            const MeshWelder::Stats weld = MeshWelder::weld(mesh, settings.weldPositionEpsilon * diagonal, settings.weldNormalEpsilon, settings.weldTexCoordEpsilon);
+            if (weld.verticesAfter < weld.verticesBefore)
+            {
+                spdlog::info("{} mesh {}: welded {} -> {} vertices ({:.1f}% fewer)", path, i, weld.verticesBefore, weld.verticesAfter,
+                    100.0 * static_cast<double>(weld.verticesBefore - weld.verticesAfter) / static_cast<double>(weld.verticesBefore));
+            }
+
+            MeshOptimizer::optimize(mesh);
+            statsAfter[i] = MeshOptimizer::analyze(mesh.indices, mesh.vertices.size());
+
+            mesh.format = VertexPacking::choose(mesh, settings);
+            if (mesh.format != settings.vertexFormat)
+            {
+                spdlog::info("{} mesh {}: quantization error above bound, using a wider vertex format", path, i);
+            }
+
+            MeshSimplifier::buildLods(mesh, settings.lodLevels, settings.lodReduction);
+        });
+        logCacheStats(path, meshes, statsBefore, statsAfter);
+        return true;
+    }
+
+    // Reads the source into unprocessed meshes: vertices, triangle indices and texture references
+    static bool load(const std::string& path, std::vector<MeshData>& meshes, std::vector<std::string>* dependencies = nullptr, Parser parser = Parser::Auto)
+    {
+        if (parser == Parser::Auto && ObjImporter::isObjFile(path))
+        {
+            std::string reason;
+            if (ObjImporter::load(path, meshes, dependencies, reason)) return true;
+            spdlog::info("{}: {}, falling back to Assimp", path, reason);
+        }
+
+        Assimp::Importer importer;
+        auto* ioSystem = new RecordingIOSystem(mappedIO());
+        importer.SetIOHandler(ioSystem);
+        const aiScene* scene = importer.ReadFile(path, IMPORT_FLAGS);
+
+        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+        {
+            std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+            return false;
+        }
+        if (dependencies) *dependencies = ioSystem->opened();
+
+        // Meshes are independent once the scene is in memory, so convert them on the worker pool
+        std::vector<std::pair<const aiMesh*, aiMatrix4x4>> sceneMeshes;
+        processNode(scene->mRootNode, aiMatrix4x4(), scene, sceneMeshes);
+
+        meshes.assign(sceneMeshes.size(), MeshData());
+        ThreadPool::shared().parallelFor(sceneMeshes.size(), [&](size_t i)
+        {
+            meshes[i] = processMesh(sceneMeshes[i].first, scene);
+            meshes[i].transform = toGlm(sceneMeshes[i].second);
+        });
+        return true;
+    }
+
+private:
+    static std::atomic<bool>& mappedIOEnabled()
+    {
+        static std::atomic<bool> enabled = true;
+        return enabled;
+    }
+
+    // File access that remembers what was opened. Owned by the Importer once installed.
+    class RecordingIOSystem : public MappedIOSystem
+    {
+    public:
+        explicit RecordingIOSystem(bool mapped) : MappedIOSystem(mapped) {}
+
+        Assimp::IOStream* Open(const char* file, const char* mode = "rb") override
+        {
+            Assimp::IOStream* stream = MappedIOSystem::Open(file, mode);
+            if (stream)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                files.emplace_back(file);
+            }
+            return stream;
+        }
+
+        std::vector<std::string> opened()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return files;
+        }
+
+    private:
+        std::mutex mutex;
+        std::vector<std::string> files;
+    };
+
+    static void processNode(const aiNode* node, const aiMatrix4x4& parentTransform, const aiScene* scene, std::vector<std::pair<const aiMesh*, aiMatrix4x4>>& sceneMeshes)
+    {
+        const aiMatrix4x4 transform = parentTransform * node->mTransformation;
+        for (unsigned i = 0; i < node->mNumMeshes; i++)
+        {
+            // Meshes of only points and lines have nothing to draw
+            const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+            if (mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) sceneMeshes.emplace_back(mesh, transform);
+        }
+        for (unsigned i = 0; i < node->mNumChildren; i++)
+        {
+            processNode(node->mChildren[i], transform, scene, sceneMeshes);
+        }
+    }
+
+    // Assimp matrices are row-major, glm is column-major
+    static glm::mat4 toGlm(const aiMatrix4x4& m)
+    {
+        return glm::mat4(
+            m.a1, m.b1, m.c1, m.d1,
+            m.a2, m.b2, m.c2, m.d2,
+            m.a3, m.b3, m.c3, m.d3,
+            m.a4, m.b4, m.c4, m.d4);
+    }
+
+    static MeshData processMesh(const aiMesh* mesh, const aiScene* scene)
+    {
+        MeshData data;
+        std::vector<Vertex>& vertices = data.vertices;
+        std::vector<unsigned int>& indices = data.indices;
+
+        vertices.resize(mesh->mNumVertices);
+        const aiVector3D* texCoords = mesh->mTextureCoords[0];
+        for (unsigned i = 0; i < mesh->mNumVertices; i++)
+        {
+            Vertex& vertex = vertices[i];
+
+            //vertex position
+            vertex.position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+
+            //vertex normals (if exist)
+            vertex.normal = mesh->mNormals ? glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z) : glm::vec3(0.0f, 0.0f, 0.0f);
+
+            //texture coords (if exist)
+            vertex.texCoords = texCoords ? glm::vec2(texCoords[i].x, texCoords[i].y) : glm::vec2(0.0f, 0.0f);
+        }
+
+        // indices: triangles only, meshes are drawn as GL_TRIANGLES. aiProcess_Triangulate leaves point and
+        // line faces as they are, and a single one would shift every later triangle.
+        indices.reserve(static_cast<size_t>(mesh->mNumFaces) * 3);
+        for (unsigned i = 0; i < mesh->mNumFaces; i++)
+        {
+            const aiFace& face = mesh->mFaces[i];
+            if (face.mNumIndices == 3) indices.insert(indices.end(), face.mIndices, face.mIndices + 3);
+        }
+
+        // materials
+        if (mesh->mMaterialIndex >= 0)
+        {
+            aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+            collectTextureRefs(material, aiTextureType_DIFFUSE, "texture_diffuse", data.textureRefs);
+            collectTextureRefs(material, aiTextureType_SPECULAR, "texture_specular", data.textureRefs);
+        }
+
+        return data;
+    }
+
+    static void bakeTransform(MeshData& mesh)
+    {
+        if (mesh.transform == glm::mat4(1.0f)) return;
+
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(mesh.transform)));
+        for (Vertex& vertex : mesh.vertices)
+        {
+            vertex.position = glm::vec3(mesh.transform * glm::vec4(vertex.position, 1.0f));
+            const glm::vec3 normal = normalMatrix * vertex.normal;
+            const float length = glm::length(normal);
+            if (length > 0.0f) vertex.normal = normal / length;
+        }
+        mesh.transform = glm::mat4(1.0f);
+    }
+
+    static void computeBounds(MeshData& mesh)
+    {
+        if (mesh.vertices.empty()) return;
+        mesh.boundsMin = mesh.boundsMax = mesh.vertices[0].position;
+        for (const Vertex& vertex : mesh.vertices)
+        {
+            mesh.boundsMin = glm::min(mesh.boundsMin, vertex.position);
+            mesh.boundsMax = glm::max(mesh.boundsMax, vertex.position);
+        }
+    }
+
+    static void logCacheStats(const std::string& path, const std::vector<MeshData>& meshData, const std::vector<CacheStats>& before, const std::vector<CacheStats>& after)
+    {
+        float trianglesTotal = 0.0f, verticesTotal = 0.0f;
+        float missesBefore = 0.0f, missesAfter = 0.0f;
+        for (size_t i = 0; i < meshData.size(); i++)
+        {
+            const auto triangles = static_cast<float>(meshData[i].lods.front().indexCount / 3);
+            spdlog::debug("{} mesh {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", path, i,
+                before[i].acmr, after[i].acmr, before[i].atvr, after[i].atvr);
+            trianglesTotal += triangles;
+            verticesTotal += static_cast<float>(meshData[i].vertices.size());
+            missesBefore += before[i].acmr * triangles;
+            missesAfter += after[i].acmr * triangles;
+        }
+        if (trianglesTotal == 0.0f) return;
+        spdlog::info("{}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f} over {} meshes", path,
+            missesBefore / trianglesTotal, missesAfter / trianglesTotal,
+            missesBefore / verticesTotal, missesAfter / verticesTotal, meshData.size());
+    }
+
+    static void collectTextureRefs(aiMaterial* mat, aiTextureType type, const std::string& typeName, std::vector<TextureRef>& refs)
+    {
+        for (unsigned i = 0; i < mat->GetTextureCount(type); i++)
+        {
+            aiString str;
+            mat->GetTexture(type, i, &str);
+            refs.push_back({ typeName, str.C_Str() });
+        }
+    }
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "LodSelector.h"
 #include "Model.h"
 
 class Node
@@ -45,25 +46,25 @@ public:
 		}
 	}
 
-	void draw(glm::mat4 parentWorld, Shader shader) const
+	void draw(glm::mat4 parentWorld, const Shader& shader, const DrawUniforms& uniforms) const
 	{
-		shader.setMat4("model", world);
+		shader.setMat4(uniforms.model, world);
 		if (sceneObject != nullptr)
 		{
-			sceneObject->draw(shader);
+			sceneObject->draw(shader, uniforms, selectLod());
 		}
 		for (Node* child : children)
 		{
-			child->draw(parentWorld, shader);
+			child->draw(parentWorld, shader, uniforms);
 		}
 	}
 
-	void drawThis(glm::mat4 parentWorld, Shader shader) const
+	void drawThis(glm::mat4 parentWorld, const Shader& shader, const DrawUniforms& uniforms) const
 	{
-		shader.setMat4("model", world);
-		if (sceneObject != nullptr) 
+		shader.setMat4(uniforms.model, world);
+		if (sceneObject != nullptr)
 		{
-			sceneObject->draw(shader);
+			sceneObject->draw(shader, uniforms, selectLod());
 		}
 	}
 
@@ -77,11 +78,20 @@ public:
 private:
 	//Shader shader;
 
+	int selectLod() const
+	{
+		glm::vec3 boundsMin, boundsMax;
+		if (!sceneObject->bounds(boundsMin, boundsMax)) return 0;
+		lodLevel = LodSelector::select(world, boundsMin, boundsMax, sceneObject->lodCount(), lodLevel);
+		return lodLevel;
+	}
+
 	glm::vec3 scale = glm::vec3(1.0f);
 	glm::mat4 world;
 	glm::mat4 local;
 
 	bool dirty;
+	mutable int lodLevel = 0;
 
 	// Scene graph variables
 	SceneObject* sceneObject;
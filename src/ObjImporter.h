@@ -0,0 +1,463 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "MeshData.h"
+#include "ThreadPool.h"
+#include "VirtualFileSystem.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OBJ_IMPORTER_SSE2
+#endif
+
+// Wavefront OBJ/MTL reader for the subset our exporters write: v, vt, vn, f with normals,
+// o, g, s, usemtl and mtllib. The file is split into line-aligned chunks that are parsed
+// in parallel, with SSE2 newline scanning and eight-digits-at-a-time number parsing.
+// Anything else makes load() fail so the caller can fall back to Assimp.
+// Meshes come out per object and material like Assimp's, with UVs flipped to match aiProcess_FlipUVs
+// and identical face corners shared instead of duplicated.
+class ObjImporter
+{
+public:
+    static bool isObjFile(const std::string& path)
+    {
+        if (path.size() < 4) return false;
+        std::string extension = path.substr(path.size() - 4);
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return extension == ".obj";
+    }
+
+    // dependencies receives the OBJ and every material library that was read.
+    // reason describes the first unsupported construct when this returns false.
+    static bool load(const std::string& path, std::vector<MeshData>& meshes, std::vector<std::string>* dependencies, std::string& reason)
+    {
+        const FileData file = VirtualFileSystem::instance().open(path);
+        if (!file.isOpen())
+        {
+            reason = "cannot open file";
+            return false;
+        }
+        const auto* begin = reinterpret_cast<const char*>(file.data());
+        const char* end = begin + file.size();
+
+        // Chunks end on line boundaries, so every worker sees whole lines
+        const size_t chunkCount = std::clamp<size_t>(file.size() / MIN_CHUNK_SIZE, 1, ThreadPool::shared().size() * 4);
+        std::vector<const char*> bounds{ begin };
+        for (size_t i = 1; i < chunkCount; i++)
+        {
+            const char* split = std::max(begin + file.size() * i / chunkCount, bounds.back());
+            split = findLineEnd(split, end);
+            bounds.push_back(split < end ? split + 1 : end);
+        }
+        bounds.push_back(end);
+
+        std::vector<Chunk> chunks(chunkCount);
+        ThreadPool::shared().parallelFor(chunkCount, [&](size_t i) { parseChunk(bounds[i], bounds[i + 1], chunks[i]); });
+        for (const Chunk& chunk : chunks)
+        {
+            if (!chunk.error.empty())
+            {
+                reason = chunk.error;
+                return false;
+            }
+        }
+
+        // Stitch the chunks together: attributes concatenate, groups get global triangle ranges
+        std::vector<glm::vec3> positions, normals;
+        std::vector<glm::vec2> texCoords;
+        std::vector<Corner> corners;
+        std::vector<Group> groups(1);
+        std::vector<std::string> libraries;
+        for (const Chunk& chunk : chunks)
+        {
+            const auto cornerBase = static_cast<uint32_t>(corners.size());
+            positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+            normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+            texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+            corners.insert(corners.end(), chunk.corners.begin(), chunk.corners.end());
+            libraries.insert(libraries.end(), chunk.libraries.begin(), chunk.libraries.end());
+            for (const Event& event : chunk.events)
+            {
+                Group next = groups.back();
+                if (event.newObject) next.object++;
+                else next.material = event.name;
+                next.firstCorner = cornerBase + event.corner;
+                if (groups.back().firstCorner == next.firstCorner) groups.back() = next;
+                else groups.push_back(next);
+            }
+        }
+
+        std::unordered_map<std::string, std::vector<TextureRef>> materials;
+        if (dependencies) dependencies->assign(1, path);
+        const std::string directory = path.substr(0, path.find_last_of('/') + 1);
+        for (const std::string& library : libraries)
+        {
+            if (loadMaterials(directory + library, materials) && dependencies) dependencies->push_back(directory + library);
+        }
+
+        // Every group becomes a mesh with its own deduplicated vertices
+        std::vector<MeshData> built(groups.size());
+        std::vector<std::string> errors(groups.size());
+        ThreadPool::shared().parallelFor(groups.size(), [&](size_t g)
+        {
+            const uint32_t first = groups[g].firstCorner;
+            const uint32_t last = g + 1 < groups.size() ? groups[g + 1].firstCorner : static_cast<uint32_t>(corners.size());
+            MeshData& mesh = built[g];
+            std::unordered_map<uint64_t, GLuint> shared;
+            shared.reserve(last - first);
+            mesh.indices.reserve(last - first);
+            for (uint32_t c = first; c < last; c++)
+            {
+                const Corner& corner = corners[c];
+                if (corner.normal == 0)
+                {
+                    errors[g] = "face without normals";
+                    return;
+                }
+                if (corner.position == 0 || corner.position > positions.size() || corner.normal > normals.size() || corner.texCoord > texCoords.size() ||
+                    std::max({ corner.position, corner.texCoord, corner.normal }) >= MAX_INDEX)
+                {
+                    errors[g] = "index out of range";
+                    return;
+                }
+                const uint64_t key = (static_cast<uint64_t>(corner.position) << 42) ^ (static_cast<uint64_t>(corner.texCoord) << 21) ^ corner.normal;
+                const auto [it, inserted] = shared.try_emplace(key, static_cast<GLuint>(mesh.vertices.size()));
+                if (inserted)
+                {
+                    Vertex vertex;
+                    vertex.position = positions[corner.position - 1];
+                    vertex.normal = normals[corner.normal - 1];
+                    vertex.texCoords = corner.texCoord ? texCoords[corner.texCoord - 1] : glm::vec2(0.0f);
+                    mesh.vertices.push_back(vertex);
+                }
+                mesh.indices.push_back(it->second);
+            }
+            const auto material = materials.find(groups[g].material);
+            if (material != materials.end()) mesh.textureRefs = material->second;
+        });
+        for (const std::string& error : errors)
+        {
+            if (!error.empty())
+            {
+                reason = error;
+                return false;
+            }
+        }
+
+        meshes.clear();
+        for (MeshData& mesh : built)
+        {
+            if (!mesh.indices.empty()) meshes.push_back(std::move(mesh));
+        }
+        return true;
+    }
+
+private:
+    static constexpr size_t MIN_CHUNK_SIZE = 256 * 1024;
+    static constexpr uint32_t MAX_INDEX = 1u << 21; // three indices share one 64-bit dedup key
+
+    // 1-based OBJ indices, 0 when the corner has no such attribute
+    struct Corner
+    {
+        uint32_t position;
+        uint32_t texCoord;
+        uint32_t normal;
+    };
+
+    // Object or material switch before the corner with the given chunk-local index
+    struct Event
+    {
+        uint32_t corner;
+        bool newObject;
+        std::string name;
+    };
+
+    struct Group
+    {
+        uint32_t object = 0;
+        std::string material;
+        uint32_t firstCorner = 0;
+    };
+
+    struct Chunk
+    {
+        std::vector<glm::vec3> positions, normals;
+        std::vector<glm::vec2> texCoords;
+        std::vector<Corner> corners; // already triangulated, three per triangle
+        std::vector<Event> events;
+        std::vector<std::string> libraries;
+        std::string error;
+    };
+
+    static const char* findLineEnd(const char* p, const char* end)
+    {
+#ifdef OBJ_IMPORTER_SSE2
+        const __m128i newline = _mm_set1_epi8('\n');
+        for (; end - p >= 16; p += 16)
+        {
+            const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), newline));
+            if (mask != 0) return p + std::countr_zero(static_cast<unsigned>(mask));
+        }
+#endif
+        const void* found = std::memchr(p, '\n', static_cast<size_t>(end - p));
+        return found ? static_cast<const char*>(found) : end;
+    }
+
+    static void parseChunk(const char* p, const char* end, Chunk& chunk)
+    {
+        std::vector<Corner> polygon;
+        while (p < end && chunk.error.empty())
+        {
+            const char* lineEnd = findLineEnd(p, end);
+            const char* next = lineEnd < end ? lineEnd + 1 : end;
+            while (lineEnd > p && (lineEnd[-1] == '\r' || lineEnd[-1] == ' ' || lineEnd[-1] == '\t')) lineEnd--;
+            p = skipSpace(p, lineEnd);
+
+            if (p == lineEnd || *p == '#')
+            {
+                // blank line or comment
+            }
+            else if (p[0] == 'v' && p + 1 < lineEnd && isSpace(p[1]))
+            {
+                glm::vec3 position;
+                if (!parseFloats(p + 1, lineEnd, &position.x, 3)) chunk.error = "malformed vertex";
+                chunk.positions.push_back(position);
+            }
+            else if (p[0] == 'v' && p + 2 < lineEnd && p[1] == 't' && isSpace(p[2]))
+            {
+                glm::vec2 texCoord;
+                if (!parseFloats(p + 2, lineEnd, &texCoord.x, 2)) chunk.error = "malformed texture coordinate";
+                texCoord.y = 1.0f - texCoord.y;
+                chunk.texCoords.push_back(texCoord);
+            }
+            else if (p[0] == 'v' && p + 2 < lineEnd && p[1] == 'n' && isSpace(p[2]))
+            {
+                glm::vec3 normal;
+                if (!parseFloats(p + 2, lineEnd, &normal.x, 3)) chunk.error = "malformed normal";
+                chunk.normals.push_back(normal);
+            }
+            else if (p[0] == 'f' && p + 1 < lineEnd && isSpace(p[1]))
+            {
+                polygon.clear();
+                if (!parseFace(p + 1, lineEnd, polygon) || polygon.size() < 3)
+                {
+                    chunk.error = "unsupported face";
+                    break;
+                }
+                // Fan triangulation, which is what aiProcess_Triangulate does for the convex faces exporters write
+                for (size_t i = 1; i + 1 < polygon.size(); i++)
+                {
+                    chunk.corners.push_back(polygon[0]);
+                    chunk.corners.push_back(polygon[i]);
+                    chunk.corners.push_back(polygon[i + 1]);
+                }
+            }
+            else
+            {
+                const char* keywordEnd = p;
+                while (keywordEnd < lineEnd && !isSpace(*keywordEnd)) keywordEnd++;
+                const std::string_view keyword(p, static_cast<size_t>(keywordEnd - p));
+                const std::string argument(skipSpace(keywordEnd, lineEnd), lineEnd);
+                const auto corner = static_cast<uint32_t>(chunk.corners.size());
+
+                if (keyword == "o" || keyword == "g") chunk.events.push_back({ corner, true, argument });
+                else if (keyword == "usemtl") chunk.events.push_back({ corner, false, argument });
+                else if (keyword == "mtllib") chunk.libraries.push_back(argument);
+                else if (keyword != "s") chunk.error = "unsupported directive '" + std::string(keyword) + "'";
+            }
+            p = next;
+        }
+    }
+
+    static bool isSpace(char c) { return c == ' ' || c == '\t'; }
+    static bool isDigit(char c) { return static_cast<unsigned char>(c - '0') < 10; }
+
+    static const char* skipSpace(const char* p, const char* end)
+    {
+        while (p < end && isSpace(*p)) p++;
+        return p;
+    }
+
+    // Parses exactly count floats; extra components such as vertex colors or w are ignored
+    static bool parseFloats(const char* p, const char* end, float* out, int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            p = parseFloat(skipSpace(p, end), end, out[i]);
+            if (p == nullptr || (p < end && !isSpace(*p))) return false;
+        }
+        return true;
+    }
+
+    static bool parseFace(const char* p, const char* end, std::vector<Corner>& polygon)
+    {
+        while (true)
+        {
+            p = skipSpace(p, end);
+            if (p == end) return true;
+
+            Corner corner{ 0, 0, 0 };
+            uint32_t* fields[3] = { &corner.position, &corner.texCoord, &corner.normal };
+            for (int field = 0; field < 3; field++)
+            {
+                if (field > 0)
+                {
+                    if (p == end || *p != '/') break;
+                    p++;
+                    if (field == 1 && p < end && *p == '/') continue; // v//vn
+                }
+                // Negative (relative) indices are left to Assimp
+                if (p == end || !isDigit(*p)) return false;
+                // Saturates, so huge indices cannot wrap around into range
+                uint32_t value = 0;
+                while (p < end && isDigit(*p)) value = std::min(value * 10 + static_cast<uint32_t>(*p++ - '0'), MAX_INDEX);
+                // OBJ indices start at 1 and 0 means "absent" in Corner, so a written 0 becomes out of range
+                *fields[field] = value != 0 ? value : MAX_INDEX;
+            }
+            if (p < end && !isSpace(*p)) return false;
+            polygon.push_back(corner);
+        }
+    }
+
+    static bool allDigits(uint64_t eight)
+    {
+        return (((eight & 0xF0F0F0F0F0F0F0F0ull) | (((eight + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull);
+    }
+
+    // Eight ASCII digits in little-endian byte order to their value, with three multiplies
+    static uint32_t parseEightDigits(uint64_t eight)
+    {
+        eight -= 0x3030303030303030ull;
+        eight = (eight * 10) + (eight >> 8);
+        return static_cast<uint32_t>((((eight & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+            (((eight >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32);
+    }
+
+    // Accumulates up to 19 significant digits into an integer mantissa; exponent tracks the decimal point.
+    // Leading zeros are not significant, so small values keep their precision.
+    static const char* readDigits(const char* p, const char* end, bool fraction, uint64_t& mantissa, int& digits, int& exponent)
+    {
+        while (end - p >= 8 && digits <= 11)
+        {
+            uint64_t eight;
+            std::memcpy(&eight, p, sizeof(eight));
+            if constexpr (std::endian::native != std::endian::little) break;
+            if (!allDigits(eight)) break;
+            mantissa = mantissa * 100000000ull + parseEightDigits(eight);
+            digits = mantissa == 0 ? 0 : digits + 8;
+            if (fraction) exponent -= 8;
+            p += 8;
+        }
+        for (; p < end && isDigit(*p); p++)
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                if (mantissa != 0) digits++;
+                if (fraction) exponent--;
+            }
+            else if (!fraction)
+            {
+                exponent++;
+            }
+        }
+        return p;
+    }
+
+    static const char* parseFloat(const char* p, const char* end, float& out)
+    {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+        uint64_t mantissa = 0;
+        int digits = 0, exponent = 0;
+        const char* start = p;
+        p = readDigits(p, end, false, mantissa, digits, exponent);
+        bool any = p != start;
+        if (p < end && *p == '.')
+        {
+            const char* fraction = ++p;
+            p = readDigits(p, end, true, mantissa, digits, exponent);
+            any |= p != fraction;
+        }
+        if (!any) return nullptr;
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            p++;
+            bool negativeExponent = false;
+            if (p < end && (*p == '-' || *p == '+')) negativeExponent = *p++ == '-';
+            if (p == end || !isDigit(*p)) return nullptr;
+            int value = 0;
+            while (p < end && isDigit(*p))
+            {
+                value = std::min(value * 10 + (*p++ - '0'), 1000);
+            }
+            exponent += negativeExponent ? -value : value;
+        }
+
+        static constexpr double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+        double value = static_cast<double>(mantissa);
+        if (exponent < 0) value = exponent >= -22 ? value / powers[-exponent] : value * std::pow(10.0, exponent);
+        else if (exponent > 0) value = exponent <= 22 ? value * powers[exponent] : value * std::pow(10.0, exponent);
+        out = static_cast<float>(negative ? -value : value);
+        return p;
+    }
+
+    // Only the maps Model binds are read; unknown statements are ignored like Assimp does
+    static bool loadMaterials(const std::string& path, std::unordered_map<std::string, std::vector<TextureRef>>& materials)
+    {
+        const FileData file = VirtualFileSystem::instance().open(path);
+        if (!file.isOpen()) return false;
+        std::istringstream in{ std::string(file.text()) };
+
+        std::vector<TextureRef>* current = nullptr;
+        std::vector<TextureRef> specular;
+        std::string line;
+        auto flushSpecular = [&]
+        {
+            if (current) current->insert(current->end(), specular.begin(), specular.end());
+            specular.clear();
+        };
+        while (std::getline(in, line))
+        {
+            while (!line.empty() && (line.back() == '\r' || isSpace(line.back()))) line.pop_back();
+            const size_t start = line.find_first_not_of(" \t");
+            if (start == std::string::npos || line[start] == '#') continue;
+            const size_t keywordEnd = line.find_first_of(" \t", start);
+            if (keywordEnd == std::string::npos) continue;
+            const std::string keyword = line.substr(start, keywordEnd - start);
+            std::string argument = line.substr(line.find_first_not_of(" \t", keywordEnd));
+
+            // Map options such as "-bm 1.0" come before the file name
+            if (keyword.rfind("map_", 0) == 0 && argument[0] == '-')
+            {
+                argument = argument.substr(argument.find_last_of(" \t") + 1);
+            }
+
+            // Diffuse maps first, then specular, like Model's collectTextureRefs order
+            if (keyword == "newmtl")
+            {
+                flushSpecular();
+                current = &materials[argument];
+            }
+            else if (keyword == "map_Kd" && current) current->push_back({ "texture_diffuse", argument });
+            else if (keyword == "map_Ks" && current) specular.push_back({ "texture_specular", argument });
+        }
+        flushSpecular();
+        return true;
+    }
+};
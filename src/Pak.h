@@ -0,0 +1,254 @@
+#pragma once
+
+#include "AssetHash.h"
+#include "LzCodec.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+// Asset package layout (native endianness, every blob 16-byte aligned):
+//   PakHeader
+//   PakEntry[entryCount], sorted by pathHash
+//   string table with the entry paths
+//   entry blobs, stored raw or LZ compressed (PAK_ENTRY_COMPRESSED)
+// Paths are relative to the directory the game runs from, in the form VirtualFileSystem::normalize() gives.
+constexpr uint32_t PAK_MAGIC = 0x4B415047; // "GPAK"
+constexpr uint32_t PAK_VERSION = 1;
+constexpr uint32_t PAK_ENTRY_COMPRESSED = 1;
+
+struct PakHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t stringTableOffset;
+    uint64_t stringTableSize;
+};
+
+struct PakEntry
+{
+    uint64_t pathHash;
+    uint64_t offset;
+    uint64_t storedSize;
+    uint64_t size;        // after decompression
+    uint64_t contentHash; // of the uncompressed bytes, so cooked data can be checked against packed sources
+    uint32_t flags;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+    uint32_t reserved;
+};
+
+// Read side of a package: maps the file once and finds entries by binary search over the index
+class Pak
+{
+public:
+    Pak() = default;
+    explicit Pak(const std::string& path) { open(path); }
+
+    bool open(const std::string& path)
+    {
+        header = nullptr;
+        if (!file.open(path)) return false;
+
+        if (file.size() < sizeof(PakHeader)) return reject();
+        header = reinterpret_cast<const PakHeader*>(file.data());
+        if (header->magic != PAK_MAGIC || header->version != PAK_VERSION) return reject();
+        if (sizeof(PakHeader) + static_cast<uint64_t>(header->entryCount) * sizeof(PakEntry) > header->stringTableOffset ||
+            header->stringTableOffset + header->stringTableSize > file.size())
+        {
+            return reject();
+        }
+
+        entries = reinterpret_cast<const PakEntry*>(file.data() + sizeof(PakHeader));
+        strings = reinterpret_cast<const char*>(file.data() + header->stringTableOffset);
+        for (uint32_t i = 0; i < header->entryCount; i++)
+        {
+            const PakEntry& entry = entries[i];
+            if (entry.offset + entry.storedSize > file.size() || static_cast<uint64_t>(entry.pathOffset) + entry.pathLength > header->stringTableSize ||
+                (!(entry.flags & PAK_ENTRY_COMPRESSED) && entry.storedSize != entry.size) ||
+                (i > 0 && entries[i - 1].pathHash > entry.pathHash))
+            {
+                return reject();
+            }
+        }
+        return true;
+    }
+
+    bool isOpen() const { return header != nullptr; }
+    size_t size() const { return isOpen() ? header->entryCount : 0; }
+    size_t fileSize() const { return file.size(); }
+    const PakEntry& entry(size_t index) const { return entries[index]; }
+
+    std::string_view path(const PakEntry& entry) const { return { strings + entry.pathOffset, entry.pathLength }; }
+
+    // path must already be normalized
+    const PakEntry* find(std::string_view path) const
+    {
+        if (!isOpen()) return nullptr;
+        const uint64_t hash = hashString(path);
+        const PakEntry* end = entries + header->entryCount;
+        const PakEntry* it = std::lower_bound(entries, end, hash, [](const PakEntry& entry, uint64_t value) { return entry.pathHash < value; });
+        for (; it != end && it->pathHash == hash; ++it)
+        {
+            if (this->path(*it) == path) return it;
+        }
+        return nullptr;
+    }
+
+    // The stored bytes; for an uncompressed entry these are the content itself
+    const uint8_t* storedData(const PakEntry& entry) const { return file.data() + entry.offset; }
+
+    // Writes entry.size bytes of content to out
+    bool extract(const PakEntry& entry, uint8_t* out) const
+    {
+        if (entry.flags & PAK_ENTRY_COMPRESSED) return LzCodec::decompress(storedData(entry), entry.storedSize, out, entry.size);
+        std::memcpy(out, storedData(entry), entry.size);
+        return true;
+    }
+
+private:
+    MappedFile file;
+    const PakHeader* header = nullptr;
+    const PakEntry* entries = nullptr;
+    const char* strings = nullptr;
+
+    bool reject()
+    {
+        file.close();
+        header = nullptr;
+        return false;
+    }
+};
+
+// Write side: collects whole files in memory, compresses them in parallel on write() and keeps
+// the compressed form of an entry only when it saves at least MIN_SAVING of its size. Formats
+// that are compressed already (JPEG, PNG) stay raw that way and cost nothing extra to read.
+class PakWriter
+{
+public:
+    static constexpr double MIN_SAVING = 0.1;
+
+    struct Stats
+    {
+        size_t entries = 0;
+        size_t compressed = 0;
+        uint64_t inputBytes = 0;
+        uint64_t storedBytes = 0;
+    };
+
+    void add(const std::string& path, std::vector<uint8_t> bytes)
+    {
+        items.push_back({ path, std::move(bytes) });
+    }
+
+    bool write(const std::string& pakPath, bool compress, Stats* stats = nullptr)
+    {
+        ThreadPool::shared().parallelFor(items.size(), [&](size_t i)
+        {
+            Item& item = items[i];
+            item.contentHash = hashBytes(item.bytes.data(), item.bytes.size());
+            if (!compress) return;
+            std::vector<uint8_t> packed = LzCodec::compress(item.bytes.data(), item.bytes.size());
+            if (static_cast<double>(packed.size()) <= static_cast<double>(item.bytes.size()) * (1.0 - MIN_SAVING))
+            {
+                item.packed = std::move(packed);
+            }
+        });
+
+        std::vector<PakEntry> index(items.size());
+        std::string stringTable;
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            PakEntry& entry = index[i];
+            entry.pathHash = hashString(items[i].path);
+            entry.pathOffset = static_cast<uint32_t>(stringTable.size());
+            entry.pathLength = static_cast<uint32_t>(items[i].path.size());
+            stringTable += items[i].path;
+        }
+
+        // Sorting a permutation keeps every entry next to its item while the index is ordered by hash
+        std::vector<size_t> order(items.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return index[a].pathHash < index[b].pathHash; });
+
+        PakHeader fileHeader{};
+        fileHeader.magic = PAK_MAGIC;
+        fileHeader.version = PAK_VERSION;
+        fileHeader.entryCount = static_cast<uint32_t>(items.size());
+        fileHeader.stringTableOffset = sizeof(PakHeader) + items.size() * sizeof(PakEntry);
+        fileHeader.stringTableSize = stringTable.size();
+
+        Stats totals;
+        std::vector<PakEntry> sorted;
+        uint64_t offset = align(fileHeader.stringTableOffset + stringTable.size());
+        for (size_t i : order)
+        {
+            PakEntry entry = index[i];
+            const Item& item = items[i];
+            const bool packed = !item.packed.empty();
+            entry.flags = packed ? PAK_ENTRY_COMPRESSED : 0;
+            entry.size = item.bytes.size();
+            entry.storedSize = packed ? item.packed.size() : item.bytes.size();
+            entry.contentHash = item.contentHash;
+            entry.offset = offset;
+            offset = align(offset + entry.storedSize);
+            sorted.push_back(entry);
+
+            totals.entries++;
+            totals.compressed += packed ? 1 : 0;
+            totals.inputBytes += entry.size;
+            totals.storedBytes += entry.storedSize;
+        }
+
+        const std::string tempPath = pakPath + ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out) return false;
+            out.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+            out.write(reinterpret_cast<const char*>(sorted.data()), static_cast<std::streamsize>(sorted.size() * sizeof(PakEntry)));
+            out.write(stringTable.data(), static_cast<std::streamsize>(stringTable.size()));
+            for (size_t slot = 0; slot < order.size(); slot++)
+            {
+                const Item& item = items[order[slot]];
+                const std::vector<uint8_t>& blob = item.packed.empty() ? item.bytes : item.packed;
+                pad(out, sorted[slot].offset);
+                out.write(reinterpret_cast<const char*>(blob.data()), static_cast<std::streamsize>(blob.size()));
+            }
+            if (!out) return false;
+        }
+        std::error_code ec;
+        std::filesystem::rename(tempPath, pakPath, ec);
+        if (ec) return false;
+        if (stats) *stats = totals;
+        return true;
+    }
+
+private:
+    struct Item
+    {
+        std::string path;
+        std::vector<uint8_t> bytes;
+        std::vector<uint8_t> packed; // empty when stored raw
+        uint64_t contentHash = 0;
+    };
+
+    std::vector<Item> items;
+
+    static uint64_t align(uint64_t offset) { return (offset + 15) & ~uint64_t(15); }
+
+    static void pad(std::ofstream& out, uint64_t offset)
+    {
+        static constexpr char zeros[16] = {};
+        const auto position = static_cast<uint64_t>(out.tellp());
+        if (offset > position) out.write(zeros, static_cast<std::streamsize>(offset - position));
+    }
+};
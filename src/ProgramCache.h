@@ -0,0 +1,149 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+#include "AssetHash.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+// Program binary cache file layout (native endianness):
+//   ProgramCacheHeader
+//   binary as returned by glGetProgramBinary
+// There is one file per program, named after its source paths and overwritten whenever the key
+// changes, so editing a shader does not pile up stale binaries.
+constexpr uint32_t PROGRAM_CACHE_MAGIC = 0x47525050; // "PPRG"
+constexpr uint32_t PROGRAM_CACHE_VERSION = 1;
+constexpr const char* PROGRAM_CACHE_DIR = "cache/programs";
+
+struct ProgramCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t binarySize;
+};
+
+// Linked programs saved with glGetProgramBinary and restored with glProgramBinary, so a warm start
+// skips GLSL compilation. A binary is only valid for the driver that produced it; the key covers the
+// source text, the defines and the driver identity, and drivers may still refuse a binary after an
+// update, in which case the caller compiles from source as if there were no cache.
+class ProgramCache
+{
+public:
+    static bool supported()
+    {
+        static const bool available = []
+        {
+            // Core since GL 4.1; glad core profiles load no ARB_get_program_binary to fall back on
+            if (!GLAD_GL_VERSION_4_1 || glProgramBinary == nullptr || glGetProgramBinary == nullptr) return false;
+            GLint formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            return formats > 0;
+        }();
+        return available;
+    }
+
+    static uint64_t key(std::initializer_list<std::string_view> sources, std::string_view defines)
+    {
+        uint64_t hash = driverHash();
+        for (std::string_view source : sources)
+        {
+            const uint64_t size = source.size(); // keeps ("ab", "c") apart from ("a", "bc")
+            hash = hashBytes(&size, sizeof(size), hash);
+            hash = hashString(source, hash);
+        }
+        return hashString(defines, hash);
+    }
+
+    // name identifies the program, key its current contents. On true the program is linked.
+    static bool load(GLuint program, std::string_view name, uint64_t key)
+    {
+        if (!supported()) return false;
+        const MappedFile file(cachePathFor(name));
+        if (!file.isOpen() || file.size() < sizeof(ProgramCacheHeader)) return false;
+
+        const auto* header = reinterpret_cast<const ProgramCacheHeader*>(file.data());
+        if (header->magic != PROGRAM_CACHE_MAGIC || header->version != PROGRAM_CACHE_VERSION || header->key != key ||
+            sizeof(ProgramCacheHeader) + static_cast<uint64_t>(header->binarySize) > file.size())
+        {
+            return false;
+        }
+
+        glProgramBinary(program, header->binaryFormat, file.data() + sizeof(ProgramCacheHeader), static_cast<GLsizei>(header->binarySize));
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) spdlog::warn("Program cache: driver rejected the binary of {}, compiling from source", name);
+        return linked != GL_FALSE;
+    }
+
+    // Call before linking a program that is going to be stored
+    static void prepare(GLuint program)
+    {
+        if (supported()) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    static bool store(GLuint program, std::string_view name, uint64_t key)
+    {
+        if (!supported()) return false;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return false;
+
+        std::vector<char> binary(static_cast<size_t>(length));
+        GLenum format = 0;
+        GLsizei written = 0;
+        glGetProgramBinary(program, length, &written, &format, binary.data());
+        if (written <= 0) return false;
+
+        const ProgramCacheHeader header{ PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_VERSION, key, format, static_cast<uint32_t>(written) };
+        const std::string cachePath = cachePathFor(name);
+        const std::string tempPath = cachePath + ".tmp";
+        std::error_code ec;
+        std::filesystem::create_directories(PROGRAM_CACHE_DIR, ec);
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out) return false;
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(binary.data(), written);
+            if (!out) return false;
+        }
+        std::filesystem::rename(tempPath, cachePath, ec);
+        return !ec;
+    }
+
+    static std::string cachePathFor(std::string_view name)
+    {
+        char file[32];
+        std::snprintf(file, sizeof(file), "%016llx.bin", static_cast<unsigned long long>(hashString(name)));
+        return std::string(PROGRAM_CACHE_DIR) + '/' + file;
+    }
+
+private:
+    // Binaries from another GPU or driver version are never even offered to the driver
+    static uint64_t driverHash()
+    {
+        static const uint64_t hash = []
+        {
+            uint64_t value = FNV_OFFSET_BASIS;
+            for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+            {
+                const auto* text = reinterpret_cast<const char*>(glGetString(name));
+                value = hashString(text != nullptr ? text : "", value);
+                value = hashString("\n", value);
+            }
+            return value;
+        }();
+        return hash;
+    }
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+
+#include "TextureLoader.h"
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+// An asset whose memory can be reclaimed. evict() frees everything the asset can rebuild on
+// its own, and the asset rebuilds it the next time it is used.
+class Resident
+{
+public:
+    virtual ~Resident() = default;
+
+    virtual bool isResident() const = 0;
+    virtual size_t gpuBytes() const = 0;
+    virtual size_t cpuBytes() const = 0;
+    virtual void evict() = 0;
+};
+
+// Keeps the memory of loaded assets under a budget by evicting the least recently drawn ones.
+// Residents report every use through touch(); update() runs once per frame and evicts from the
+// cold end of the list until the total fits. Texture memory counts towards the budget as well:
+// textures are shared through TextureCache and go away with the last asset that references them.
+// Assets used in the current frame are never evicted, so a budget smaller than one frame's
+// working set degrades to keeping just that frame resident. GL thread only.
+class ResidencyManager
+{
+public:
+    static ResidencyManager& instance()
+    {
+        static ResidencyManager manager;
+        return manager;
+    }
+
+    // 0 disables eviction
+    void setBudget(size_t bytes) { budget = bytes; }
+    size_t getBudget() const { return budget; }
+
+    void add(Resident* resident)
+    {
+        order.push_front(resident);
+        entries[resident] = { order.begin(), frame };
+    }
+
+    void remove(Resident* resident)
+    {
+        const auto entry = entries.find(resident);
+        if (entry == entries.end()) return;
+        order.erase(entry->second.position);
+        entries.erase(entry);
+    }
+
+    void touch(Resident* resident)
+    {
+        const auto entry = entries.find(resident);
+        if (entry == entries.end()) return;
+        order.splice(order.begin(), order, entry->second.position);
+        entry->second.lastUsed = frame;
+    }
+
+    // Evicts until the budget holds, then starts the next frame. Call after the frame's draws.
+    void update()
+    {
+        if (budget > 0 && usedBytes() > budget)
+        {
+            size_t evicted = 0, freed = 0;
+            for (auto it = order.rbegin(); it != order.rend() && usedBytes() > budget; ++it)
+            {
+                Resident* resident = *it;
+                if (!resident->isResident() || entries[resident].lastUsed == frame) continue;
+
+                const size_t before = usedBytes();
+                resident->evict();
+                freed += before - std::min(before, usedBytes());
+                evicted++;
+            }
+            if (evicted > 0)
+            {
+                spdlog::info("Residency: evicted {} assets, {:.1f} MB freed, {:.1f} of {:.1f} MB in use", evicted,
+                    megabytes(freed), megabytes(usedBytes()), megabytes(budget));
+            }
+        }
+        frame++;
+    }
+
+    size_t usedBytes() const
+    {
+        size_t total = TextureLoader::instance().gpuBytes();
+        for (const Resident* resident : order)
+        {
+            if (resident->isResident()) total += resident->gpuBytes() + resident->cpuBytes();
+        }
+        return total;
+    }
+
+    size_t residentCount() const
+    {
+        size_t count = 0;
+        for (const Resident* resident : order)
+        {
+            if (resident->isResident()) count++;
+        }
+        return count;
+    }
+
+    size_t size() const { return order.size(); }
+
+    static double megabytes(size_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); }
+
+private:
+    struct Entry
+    {
+        std::list<Resident*>::iterator position;
+        uint64_t lastUsed = 0;
+    };
+
+    std::list<Resident*> order; // most recently used first
+    std::unordered_map<Resident*, Entry> entries;
+    size_t budget = 0;
+    uint64_t frame = 1;
+
+    ResidencyManager() = default;
+};
@@ -1,10 +1,20 @@
 #pragma once
 
+#include <glm/glm.hpp>
+
+#include "DrawUniforms.h"
 #include "Shader.h"
 
 class SceneObject
 {
 public:
 	virtual ~SceneObject() = default;
-	virtual void draw(const Shader& shader) const = 0;
+	virtual void draw(const Shader& shader, const DrawUniforms& uniforms) const = 0;
+
+	// Level-of-detail aware drawing; objects without levels just draw themselves
+	virtual void draw(const Shader& shader, const DrawUniforms& uniforms, int lod) const { draw(shader, uniforms); }
+	virtual int lodCount() const { return 1; }
+
+	// Local-space bounding box, false when the object has none
+	virtual bool bounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const { return false; }
 };
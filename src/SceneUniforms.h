@@ -0,0 +1,108 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "DirectionalLight.h"
+#include "PointLight.h"
+#include "SpotLight.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// CPU mirrors of the std140 blocks in the shaders. Every vec3 is followed by a scalar or an
+// explicit pad so it takes the 16 bytes std140 gives it; bools are 4-byte ints. Keep in sync with
+// res/shaders/include/frame.glsl and lights.glsl.
+constexpr int MAX_POINT_LIGHTS = 16; // injected into the shaders as NR_POINT_LIGHTS
+constexpr int MAX_SPOT_LIGHTS = 8;   // injected into the shaders as NR_SPOT_LIGHTS
+
+// uniform FrameData
+struct FrameUniforms
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 cameraPosition;
+    float pad0 = 0.0f;
+};
+
+struct DirLightStd140
+{
+    glm::vec3 direction;
+    int32_t enabled;
+    glm::vec3 ambient;
+    float pad0;
+    glm::vec3 diffuse;
+    float pad1;
+    glm::vec3 specular;
+    float pad2;
+};
+
+struct PointLightStd140
+{
+    glm::vec3 position;
+    int32_t enabled;
+    glm::vec3 ambient;
+    float constant;
+    glm::vec3 diffuse;
+    float linear;
+    glm::vec3 specular;
+    float quadratic;
+};
+
+struct SpotLightStd140
+{
+    glm::vec3 position;
+    int32_t enabled;
+    glm::vec3 direction;
+    float cutOff;
+    glm::vec3 ambient;
+    float outerCutOff;
+    glm::vec3 diffuse;
+    float constant;
+    glm::vec3 specular;
+    float linear;
+    float quadratic;
+    float pad0[3];
+};
+
+// uniform LightData; only the first pointLightCount and spotLightCount entries are read
+struct LightUniforms
+{
+    DirLightStd140 dirLight;
+    PointLightStd140 pointLights[MAX_POINT_LIGHTS];
+    SpotLightStd140 spotLights[MAX_SPOT_LIGHTS];
+    int32_t pointLightCount = 0;
+    int32_t spotLightCount = 0;
+    int32_t pad0[2];
+
+    void setDirectional(const DirectionalLight& light, bool enabled)
+    {
+        dirLight = { light.direction, enabled ? 1 : 0, light.ambient, 0.0f, light.diffuse, 0.0f, light.specular, 0.0f };
+    }
+
+    bool addPoint(const PointLight& light, bool enabled = true)
+    {
+        if (pointLightCount >= MAX_POINT_LIGHTS) return false;
+        pointLights[pointLightCount++] = { light.position, enabled ? 1 : 0, light.ambient, light.constant,
+            light.diffuse, light.linear, light.specular, light.quadratic };
+        return true;
+    }
+
+    bool addSpot(const SpotLight& light, bool enabled = true)
+    {
+        if (spotLightCount >= MAX_SPOT_LIGHTS) return false;
+        spotLights[spotLightCount++] = { light.position, enabled ? 1 : 0, light.direction, light.cutOff,
+            light.ambient, light.outerCutOff, light.diffuse, light.constant, light.specular, light.linear,
+            light.quadratic, { 0.0f, 0.0f, 0.0f } };
+        return true;
+    }
+};
+
+static_assert(sizeof(glm::vec3) == 12, "std140 mirrors expect tightly packed glm vectors");
+static_assert(offsetof(FrameUniforms, cameraPosition) == 128 && sizeof(FrameUniforms) == 144);
+static_assert(sizeof(DirLightStd140) == 64);
+static_assert(sizeof(PointLightStd140) == 64);
+static_assert(offsetof(SpotLightStd140, quadratic) == 80 && sizeof(SpotLightStd140) == 96);
+static_assert(offsetof(LightUniforms, pointLights) == 64);
+static_assert(offsetof(LightUniforms, spotLights) == 64 + 64 * MAX_POINT_LIGHTS);
+static_assert(offsetof(LightUniforms, pointLightCount) == 64 + 64 * MAX_POINT_LIGHTS + 96 * MAX_SPOT_LIGHTS);
+static_assert(sizeof(LightUniforms) % 16 == 0);
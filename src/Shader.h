@@ -1,89 +1,124 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <spdlog/spdlog.h>
 
+#include "AssetHash.h"
+#include "ProgramCache.h"
+#include "ShaderPreprocessor.h"
+#include "UniformBuffer.h"
+#include "VirtualFileSystem.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <string_view>
 #include <iostream>
+#include <vector>
+
+// A uniform name registered with one Shader; see Shader::uniform()
+struct UniformHandle
+{
+    static constexpr uint32_t NONE = UINT32_MAX;
+    uint32_t slot = NONE;
+};
 
+// Shared by GL_KHR_parallel_shader_compile and GL_ARB_parallel_shader_compile
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Until its program has linked, a shader draws with a shared fallback program (flat grey, same
+// inputs as the lit shaders), so an asynchronous build or a broken source never stalls a frame
+// or leaves the program unbound.
 class Shader
 {
 public:
+    enum class Compile
+    {
+        Blocking, // the program is ready when the constructor returns
+        Async,    // compiles while frames render; poll() switches over once it is done
+    };
+
     GLuint id;
     Shader() { id = 0; }
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, Compile mode = Compile::Blocking,
+        const ShaderDefines& defines = {})
     {
-        std::string vertexCode, fragmentCode, geometryCode;
-        std::ifstream vShaderFile, fShaderFile, gShaderFile;
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
+        this->vertexPath = vertexPath;
+        this->fragmentPath = fragmentPath;
+        if (geometryPath != nullptr) this->geometryPath = geometryPath;
+        this->defines = defines;
 
-            std::stringstream vShaderStream, fShaderStream;
-
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-
-            vShaderFile.close();
-            fShaderFile.close();
-
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
+        id = fallbackProgram();
+        cacheUniforms();
+        submit();
+        if (mode == Compile::Blocking) finish();
+    }
 
-            if (geometryPath != nullptr)
-            {
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
+    // Lets the driver compile on threads of its own and report progress without blocking. Call
+    // once after the GL loader, with the same loader, before any shader is built.
+    static void enableParallelCompile(GLADloadproc loader)
+    {
+        GLint extensionCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+        const char* maxThreadsName = nullptr;
+        for (GLint i = 0; i < extensionCount; i++)
+        {
+            const auto* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+            if (name && std::strcmp(name, "GL_KHR_parallel_shader_compile") == 0) maxThreadsName = "glMaxShaderCompilerThreadsKHR";
+            if (name && std::strcmp(name, "GL_ARB_parallel_shader_compile") == 0 && !maxThreadsName) maxThreadsName = "glMaxShaderCompilerThreadsARB";
         }
-        catch (std::ifstream::failure& e)
+        if (!maxThreadsName)
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+            spdlog::info("Parallel shader compilation is not supported; programs are still submitted before any status query");
+            return;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
 
-        //compile shaders
-        GLuint vertex, fragment;
-
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, 0);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, 0);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-
-        GLuint geometry;
-        if (geometryPath != nullptr)
-        {
-            const char* gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, 0);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
-        }
+        using MaxShaderCompilerThreads = void (APIENTRYP)(GLuint count);
+        const auto maxThreads = reinterpret_cast<MaxShaderCompilerThreads>(loader(maxThreadsName));
+        if (!maxThreads) return;
+        maxThreads(0xFFFFFFFFu); // as many threads as the driver sees fit
+        parallelCompile() = true;
+        spdlog::info("Parallel shader compilation enabled");
+    }
+
+    // Rebuilds the program from its source files in the background; poll() switches to it once it
+    // has linked, and on failure the current program stays in use. Uniform values start over with
+    // the new program, so values set only once must be set again.
+    void reload()
+    {
+        if (pending.program != 0) discard();
+        submit();
+    }
 
-        id = glCreateProgram();
-        glAttachShader(id, vertex);
-        glAttachShader(id, fragment);
-        if (geometryPath != nullptr) glAttachShader(id, geometry);
-        glLinkProgram(id);
-        checkCompileErrors(id, "PROGRAM");
+    // Call once per frame. Installs a build the driver has finished and returns whether the shader
+    // draws with its own program.
+    bool poll()
+    {
+        if (pending.program != 0 && isComplete(pending.program)) finish();
+        return ready();
+    }
+
+    bool ready() const
+    {
+        return id != 0 && id != fallbackProgram();
+    }
+
+    // Every file the last build read, included ones too
+    std::vector<std::string> sourcePaths() const
+    {
+        return dependencies;
+    }
 
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if (geometryPath != nullptr) glDeleteShader(geometry);
+    // Deletes the programs; the shader draws nothing useful afterwards
+    void release()
+    {
+        discard();
+        if (ready()) glDeleteProgram(id);
+        id = 0;
     }
 
     void use() const
@@ -91,68 +126,356 @@ public:
         glUseProgram(id);
     }
 
-    void setBool(const std::string& name, bool value) const
+    // Registers name on first use. Handles stay valid across reload(), since each is resolved again against the new program.
+    UniformHandle uniform(std::string_view name)
     {
-        glUniform1i(glGetUniformLocation(id, name.c_str()), static_cast<int>(value));
+        const uint64_t hash = hashString(name);
+        const uint32_t slot = findSlot(name, hash);
+        return { slot != UniformHandle::NONE ? slot : addSlot(name, hash, -1) };
     }
 
-    void setInt(const std::string& name, int value) const
+    // -1 for names that are not an active uniform of the program, like glGetUniformLocation
+    GLint location(std::string_view name) const
     {
-        glUniform1i(glGetUniformLocation(id, name.c_str()), value);
+        const uint32_t slot = findSlot(name, hashString(name));
+        return slot != UniformHandle::NONE ? slots[slot].location : -1;
     }
 
-    void setFloat(const std::string& name, float value) const
+    GLint location(UniformHandle handle) const
     {
-        glUniform1f(glGetUniformLocation(id, name.c_str()), value);
+        return handle.slot < slots.size() ? slots[handle.slot].location : -1;
     }
 
-    void setVec2(const std::string& name, const glm::vec2& value) const
+    void setBool(std::string_view name, bool value) const { upload(location(name), value); }
+    void setBool(UniformHandle handle, bool value) const { upload(location(handle), value); }
+
+    void setInt(std::string_view name, int value) const { upload(location(name), value); }
+    void setInt(UniformHandle handle, int value) const { upload(location(handle), value); }
+
+    void setFloat(std::string_view name, float value) const { upload(location(name), value); }
+    void setFloat(UniformHandle handle, float value) const { upload(location(handle), value); }
+
+    void setVec2(std::string_view name, const glm::vec2& value) const { upload(location(name), value); }
+    void setVec2(UniformHandle handle, const glm::vec2& value) const { upload(location(handle), value); }
+
+    void setVec2(std::string_view name, float x, float y) const
     {
-        glUniform2fv(glGetUniformLocation(id, name.c_str()), 1, &value[0]);
+        glUniform2f(location(name), x, y);
     }
 
-    void setVec2(const std::string& name, float x, float y) const
+    void setVec3(std::string_view name, const glm::vec3& value) const { upload(location(name), value); }
+    void setVec3(UniformHandle handle, const glm::vec3& value) const { upload(location(handle), value); }
+
+    void setVec3(std::string_view name, float x, float y, float z) const
     {
-        glUniform2f(glGetUniformLocation(id, name.c_str()), x, y);
+        glUniform3f(location(name), x, y, z);
     }
 
-    void setVec3(const std::string& name, const glm::vec3& value) const
+    void setVec4(std::string_view name, const glm::vec4& value) const { upload(location(name), value); }
+    void setVec4(UniformHandle handle, const glm::vec4& value) const { upload(location(handle), value); }
+
+    void sSetVec4(std::string_view name, float x, float y, float z, float w)
     {
-        glUniform3fv(glGetUniformLocation(id, name.c_str()), 1, &value[0]);
+        glUniform4f(location(name), x, y, z, w);
     }
 
-    void setVec3(const std::string& name, float x, float y, float z) const
+    void setMat2(std::string_view name, const glm::mat2& mat) const { upload(location(name), mat); }
+    void setMat2(UniformHandle handle, const glm::mat2& mat) const { upload(location(handle), mat); }
+
+    void setMat3(std::string_view name, const glm::mat3& mat) const { upload(location(name), mat); }
+    void setMat3(UniformHandle handle, const glm::mat3& mat) const { upload(location(handle), mat); }
+
+    void setMat4(std::string_view name, const glm::mat4& mat) const { upload(location(name), mat); }
+    void setMat4(UniformHandle handle, const glm::mat4& mat) const { upload(location(handle), mat); }
+
+private:
+    struct UniformSlot
+    {
+        std::string name;
+        uint64_t hash;
+        GLint location; // -1 while the name is not active in the current program
+    };
+
+    static constexpr size_t STAGE_COUNT = 3; // vertex, fragment, geometry
+
+    // A build handed to the driver whose status has not been queried yet; program is 0 when there is none
+    struct PendingBuild
     {
-        glUniform3f(glGetUniformLocation(id, name.c_str()), x, y, z);
+        GLuint program = 0;
+        GLuint stages[STAGE_COUNT] = {}; // 0 for absent stages and restored programs
+        std::vector<std::string> files[STAGE_COUNT]; // per stage, in source string order
+        std::string cacheName;
+        uint64_t cacheKey = 0;
+        bool restored = false;           // linked from ProgramCache
+    };
+
+    std::string vertexPath, fragmentPath, geometryPath;
+    ShaderDefines defines;
+    std::vector<std::string> dependencies;
+    PendingBuild pending;
+    std::vector<UniformSlot> slots;     // indexed by UniformHandle::slot
+    std::vector<uint32_t> slotTable;    // open addressing over slots by name hash: slot + 1, 0 when empty
+
+    static void upload(GLint location, bool value) { glUniform1i(location, static_cast<int>(value)); }
+    static void upload(GLint location, int value) { glUniform1i(location, value); }
+    static void upload(GLint location, float value) { glUniform1f(location, value); }
+    static void upload(GLint location, const glm::vec2& value) { glUniform2fv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::vec3& value) { glUniform3fv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::vec4& value) { glUniform4fv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::mat2& mat) { glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]); }
+    static void upload(GLint location, const glm::mat3& mat) { glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]); }
+    static void upload(GLint location, const glm::mat4& mat) { glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]); }
+
+    // Shared blocks the program declares read from their fixed binding points (UNIFORM_BLOCKS)
+    static void bindUniformBlocks(GLuint program)
+    {
+        for (const UniformBlockBinding& block : UNIFORM_BLOCKS)
+        {
+            const GLuint index = glGetUniformBlockIndex(program, block.name);
+            if (index != GL_INVALID_INDEX) glUniformBlockBinding(program, index, block.binding);
+        }
     }
 
-    void setVec4(const std::string& name, const glm::vec4& value) const
+    // Asks the driver for every active uniform once, after each link, so setters never have to.
+    // Arrays are reported once as "name[0]"; every element gets its own entry and the bare name
+    // refers to the first, as with glGetUniformLocation.
+    void cacheUniforms()
     {
-        glUniform4fv(glGetUniformLocation(id, name.c_str()), 1, &value[0]);
+        for (UniformSlot& slot : slots) slot.location = -1;
+
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<char> buffer(static_cast<size_t>(std::max(maxLength, 1)));
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(id, static_cast<GLuint>(i), static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data());
+            const std::string_view name(buffer.data(), static_cast<size_t>(length));
+            if (!name.ends_with("[0]"))
+            {
+                // Members of uniform blocks have no location and are skipped
+                cacheLocation(name, glGetUniformLocation(id, buffer.data()));
+                continue;
+            }
+
+            const std::string base(name.substr(0, name.size() - 3));
+            cacheLocation(base, glGetUniformLocation(id, base.c_str()));
+            for (GLint element = 0; element < size; element++)
+            {
+                const std::string elementName = base + '[' + std::to_string(element) + ']';
+                cacheLocation(elementName, glGetUniformLocation(id, elementName.c_str()));
+            }
+        }
     }
 
-    void sSetVec4(const std::string& name, float x, float y, float z, float w)
+    void cacheLocation(std::string_view name, GLint location)
     {
-        glUniform4f(glGetUniformLocation(id, name.c_str()), x, y, z, w);
+        if (location < 0) return;
+        const uint64_t hash = hashString(name);
+        const uint32_t slot = findSlot(name, hash);
+        if (slot != UniformHandle::NONE) slots[slot].location = location;
+        else addSlot(name, hash, location);
     }
 
-    void setMat2(const std::string& name, const glm::mat2& mat) const
+    uint32_t findSlot(std::string_view name, uint64_t hash) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        if (slotTable.empty()) return UniformHandle::NONE;
+        const size_t mask = slotTable.size() - 1;
+        for (size_t i = hash & mask; slotTable[i] != 0; i = (i + 1) & mask)
+        {
+            const UniformSlot& slot = slots[slotTable[i] - 1];
+            if (slot.hash == hash && slot.name == name) return slotTable[i] - 1;
+        }
+        return UniformHandle::NONE;
     }
 
-    void setMat3(const std::string& name, const glm::mat3& mat) const
+    uint32_t addSlot(std::string_view name, uint64_t hash, GLint location)
     {
-        glUniformMatrix3fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        const auto slot = static_cast<uint32_t>(slots.size());
+        slots.push_back({ std::string(name), hash, location });
+
+        // Kept at most half full so probe runs stay short
+        if (slots.size() * 2 > slotTable.size())
+        {
+            slotTable.assign(std::max<size_t>(16, slotTable.size() * 2), 0);
+            for (uint32_t i = 0; i < slots.size(); i++) insertSlot(i);
+        }
+        else
+        {
+            insertSlot(slot);
+        }
+        return slot;
     }
 
-    void setMat4(const std::string& name, const glm::mat4& mat) const
+    void insertSlot(uint32_t slot)
     {
-        glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        const size_t mask = slotTable.size() - 1;
+        size_t i = slots[slot].hash & mask;
+        while (slotTable[i] != 0) i = (i + 1) & mask;
+        slotTable[i] = slot + 1;
     }
 
-private:
-    static void checkCompileErrors(const GLuint shader, const std::string type)
+    // Hands the sources to the driver, or restores the program from ProgramCache when the sources and
+    // the driver are the ones it was stored with. Nothing here waits for the compiler: status is only
+    // queried in finish(), which lets drivers with parallel compilation overlap every submitted program.
+    void submit()
+    {
+        std::string codes[STAGE_COUNT];
+        const std::string* paths[STAGE_COUNT] = { &vertexPath, &fragmentPath, &geometryPath };
+        dependencies.clear();
+        for (size_t i = 0; i < STAGE_COUNT; i++)
+        {
+            if (paths[i]->empty()) continue;
+            // A stage that cannot be read still goes to the compiler, which then fails the build
+            ShaderPreprocessor::process(*paths[i], defines, codes[i], pending.files[i]);
+            for (const std::string& file : pending.files[i])
+            {
+                if (std::find(dependencies.begin(), dependencies.end(), file) == dependencies.end()) dependencies.push_back(file);
+            }
+        }
+
+        const std::string defineText = defines.text();
+        pending.cacheName = vertexPath + '|' + fragmentPath + '|' + geometryPath + '|' + defineText;
+        pending.cacheKey = ProgramCache::key({ codes[0], codes[1], codes[2] }, defineText);
+        pending.program = glCreateProgram();
+        if (ProgramCache::load(pending.program, pending.cacheName, pending.cacheKey))
+        {
+            pending.restored = true;
+            return;
+        }
+
+        //compile shaders
+        static constexpr GLenum types[STAGE_COUNT] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER };
+        for (size_t i = 0; i < STAGE_COUNT; i++)
+        {
+            if (paths[i]->empty()) continue;
+            const char* code = codes[i].c_str();
+            pending.stages[i] = glCreateShader(types[i]);
+            glShaderSource(pending.stages[i], 1, &code, 0);
+            glCompileShader(pending.stages[i]);
+            glAttachShader(pending.program, pending.stages[i]);
+        }
+        ProgramCache::prepare(pending.program);
+        glLinkProgram(pending.program);
+    }
+
+    // Collects the submitted build, waiting for the driver if it is not done yet, and switches to
+    // the new program when it linked
+    bool finish()
+    {
+        bool linked = pending.restored;
+        if (!pending.restored)
+        {
+            static constexpr const char* names[STAGE_COUNT] = { "VERTEX", "FRAGMENT", "GEOMETRY" };
+            linked = true;
+            for (size_t i = 0; i < STAGE_COUNT; i++)
+            {
+                if (pending.stages[i] == 0 || checkCompileErrors(pending.stages[i], names[i])) continue;
+                linked = false;
+                // Messages name source strings by number; these are the files behind them
+                if (pending.files[i].size() < 2) continue;
+                for (size_t file = 0; file < pending.files[i].size(); file++)
+                {
+                    std::cout << "  source string " << file << ": " << pending.files[i][file] << std::endl;
+                }
+            }
+            linked = checkCompileErrors(pending.program, "PROGRAM") && linked;
+            if (linked) ProgramCache::store(pending.program, pending.cacheName, pending.cacheKey);
+        }
+
+        if (linked)
+        {
+            if (ready()) glDeleteProgram(id);
+            id = pending.program;
+            pending.program = 0;
+            bindUniformBlocks(id);
+            cacheUniforms();
+        }
+        discard();
+        return linked;
+    }
+
+    // Drops whatever is left of the pending build
+    void discard()
+    {
+        for (GLuint& stage : pending.stages)
+        {
+            if (stage != 0) glDeleteShader(stage);
+        }
+        if (pending.program != 0) glDeleteProgram(pending.program);
+        pending = PendingBuild();
+    }
+
+    static bool isComplete(GLuint program)
+    {
+        // Without the extension there is no way to ask, and any status query blocks until done
+        if (!parallelCompile()) return true;
+        GLint complete = GL_FALSE;
+        glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &complete);
+        return complete != GL_FALSE;
+    }
+
+    static bool& parallelCompile()
+    {
+        static bool enabled = false;
+        return enabled;
+    }
+
+    static GLuint fallbackProgram()
+    {
+        static const GLuint program = []
+        {
+            const char* vertexCode = R"(#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+layout (std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPosition;
+};
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos * positionScale + positionOffset, 1.0);
+}
+)";
+            const char* fragmentCode = R"(#version 330 core
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = vec4(0.5, 0.5, 0.5, 1.0);
+}
+)";
+            const GLuint vertex = glCreateShader(GL_VERTEX_SHADER);
+            glShaderSource(vertex, 1, &vertexCode, 0);
+            glCompileShader(vertex);
+            const GLuint fragment = glCreateShader(GL_FRAGMENT_SHADER);
+            glShaderSource(fragment, 1, &fragmentCode, 0);
+            glCompileShader(fragment);
+
+            const GLuint fallback = glCreateProgram();
+            glAttachShader(fallback, vertex);
+            glAttachShader(fallback, fragment);
+            glLinkProgram(fallback);
+            checkCompileErrors(fallback, "PROGRAM");
+            glDeleteShader(vertex);
+            glDeleteShader(fragment);
+            bindUniformBlocks(fallback);
+            return fallback;
+        }();
+        return program;
+    }
+
+    static bool checkCompileErrors(const GLuint shader, const std::string type)
     {
         int success;
         char infoLog[1024];
@@ -174,5 +497,6 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n\n\n" << std::endl;
             }
         }
+        return success != 0;
     }
 };
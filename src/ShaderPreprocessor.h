@@ -0,0 +1,168 @@
+#pragma once
+
+#include "AssetHash.h"
+#include "VirtualFileSystem.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Preprocessor symbols a shader variant is compiled with. Kept sorted by name, so equal sets
+// give the same text and hash whatever order they were set in.
+class ShaderDefines
+{
+public:
+    ShaderDefines() = default;
+    ShaderDefines(std::initializer_list<std::pair<std::string, std::string>> values)
+    {
+        for (const auto& [name, value] : values) set(name, value);
+    }
+
+    // Replaces an earlier value of name
+    ShaderDefines& set(const std::string& name, const std::string& value = "1")
+    {
+        const auto it = std::lower_bound(values.begin(), values.end(), name, [](const auto& entry, const std::string& key) { return entry.first < key; });
+        if (it != values.end() && it->first == name) it->second = value;
+        else values.insert(it, { name, value });
+        return *this;
+    }
+
+    ShaderDefines& set(const std::string& name, int value)
+    {
+        return set(name, std::to_string(value));
+    }
+
+    bool empty() const { return values.empty(); }
+
+    // One "#define NAME VALUE" line per symbol
+    std::string text() const
+    {
+        std::string lines;
+        for (const auto& [name, value] : values) lines += "#define " + name + ' ' + value + '\n';
+        return lines;
+    }
+
+    uint64_t hash() const { return hashString(text()); }
+
+private:
+    std::vector<std::pair<std::string, std::string>> values; // sorted by name
+};
+
+// Turns a shader file into the text handed to glShaderSource: the #version line, the injected
+// defines, then the source with every #include "file" replaced by that file. Include paths are
+// relative to the including file and each file is pulled in once per stage, which makes include
+// guards unnecessary and cycles harmless. #line directives keep compiler messages pointing at
+// the original lines; their source string numbers index the files list.
+class ShaderPreprocessor
+{
+public:
+    static constexpr int MAX_INCLUDE_DEPTH = 16;
+
+    // files receives every file read, the stage's own file first
+    static bool process(const std::string& path, const ShaderDefines& defines, std::string& out, std::vector<std::string>& files)
+    {
+        out.clear();
+        files = { normalize(path) };
+        return expand(0, defines.text(), out, files, 0);
+    }
+
+private:
+    static std::string normalize(const std::string& path)
+    {
+        return std::filesystem::path(path).lexically_normal().generic_string();
+    }
+
+    static bool expand(size_t fileIndex, const std::string& defines, std::string& out, std::vector<std::string>& files, int depth)
+    {
+        const std::string path = files[fileIndex];
+        std::string source;
+        if (!VirtualFileSystem::instance().readText(path, source))
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+            return false;
+        }
+
+        // Without a #version line the defines open the root file
+        const bool root = fileIndex == 0;
+        bool definesPending = root;
+        if (root && source.find("#version") == std::string::npos)
+        {
+            out += defines;
+            out += "#line 1 0\n";
+            definesPending = false;
+        }
+
+        size_t lineNumber = 0;
+        for (size_t start = 0; start < source.size();)
+        {
+            size_t end = source.find('\n', start);
+            if (end == std::string::npos) end = source.size();
+            const std::string_view line(source.data() + start, end - start);
+            const std::string_view directive = trimmed(line);
+            start = end + 1;
+            lineNumber++;
+
+            if (definesPending && directive.starts_with("#version"))
+            {
+                out.append(line);
+                out += '\n';
+                out += defines;
+                out += "#line " + std::to_string(lineNumber + 1) + " 0\n";
+                definesPending = false;
+                continue;
+            }
+            if (directive.starts_with("#pragma once"))
+            {
+                out += '\n';
+                continue;
+            }
+            if (!directive.starts_with("#include"))
+            {
+                out.append(line);
+                out += '\n';
+                continue;
+            }
+
+            const size_t open = directive.find('"');
+            const size_t close = open == std::string_view::npos ? open : directive.find('"', open + 1);
+            if (close == std::string_view::npos)
+            {
+                std::cout << "ERROR::SHADER::MALFORMED_INCLUDE: " << path << '(' << lineNumber << ')' << std::endl;
+                return false;
+            }
+            if (depth >= MAX_INCLUDE_DEPTH)
+            {
+                std::cout << "ERROR::SHADER::INCLUDE_TOO_DEEP: " << path << '(' << lineNumber << ')' << std::endl;
+                return false;
+            }
+
+            const std::string included = normalize((std::filesystem::path(path).parent_path() / std::string(directive.substr(open + 1, close - open - 1))).string());
+            if (std::find(files.begin(), files.end(), included) != files.end())
+            {
+                out += '\n';
+                continue;
+            }
+            files.push_back(included);
+            const size_t includedIndex = files.size() - 1;
+            out += "#line 1 " + std::to_string(includedIndex) + '\n';
+            if (!expand(includedIndex, defines, out, files, depth + 1)) return false;
+            out += "#line " + std::to_string(lineNumber + 1) + ' ' + std::to_string(fileIndex) + '\n';
+        }
+        return true;
+    }
+
+    static std::string_view trimmed(std::string_view line)
+    {
+        const size_t first = line.find_first_not_of(" \t");
+        if (first == std::string_view::npos) return {};
+        line.remove_prefix(first);
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) line.remove_suffix(1);
+        return line;
+    }
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "AssetHash.h"
+#include "AssetWatcher.h"
+#include "Shader.h"
+#include "ShaderPreprocessor.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Stage files of one program; geometry stays empty for programs without that stage
+struct ShaderSources
+{
+    std::string vertex;
+    std::string fragment;
+    std::string geometry;
+};
+
+// Programs keyed by (source set, defines hash). A variant is built on its first request and the
+// same Shader is handed out afterwards, so code can ask for exactly the variant a draw needs
+// without paying for it twice. Every variant watches all files its last build read, includes
+// too, and rebuilds when one of them changes.
+class ShaderVariants
+{
+public:
+    static ShaderVariants& instance()
+    {
+        static ShaderVariants variants;
+        return variants;
+    }
+
+    // The reference stays valid until clear()
+    Shader& get(const ShaderSources& sources, const ShaderDefines& defines = {}, Shader::Compile mode = Shader::Compile::Async)
+    {
+        const Key key{ hashString(sources.vertex + '|' + sources.fragment + '|' + sources.geometry), defines.hash() };
+        if (const auto it = variants.find(key); it != variants.end()) return *it->second.shader;
+
+        Variant& variant = variants[key];
+        variant.shader = std::make_unique<Shader>(sources.vertex.c_str(), sources.fragment.c_str(),
+            sources.geometry.empty() ? nullptr : sources.geometry.c_str(), mode, defines);
+        watch(key, variant);
+        return *variant.shader;
+    }
+
+    // Call once per frame; see Shader::poll()
+    void poll()
+    {
+        for (auto& [key, variant] : variants) variant.shader->poll();
+    }
+
+    size_t size() const { return variants.size(); }
+
+    // Deletes every program; call while the GL context still exists
+    void clear()
+    {
+        for (auto& [key, variant] : variants)
+        {
+            for (uint64_t subscription : variant.watches) AssetWatcher::instance().unsubscribe(subscription);
+            variant.shader->release();
+        }
+        variants.clear();
+    }
+
+private:
+    using Key = std::pair<uint64_t, uint64_t>; // source paths hash, defines hash
+
+    struct Variant
+    {
+        std::unique_ptr<Shader> shader;
+        std::vector<std::string> watchedFiles;
+        std::vector<uint64_t> watches;
+    };
+
+    std::map<Key, Variant> variants;
+
+    ShaderVariants() = default;
+
+    // Follows the include list, which may change with every edit
+    void watch(const Key& key, Variant& variant)
+    {
+        const std::vector<std::string> files = variant.shader->sourcePaths();
+        if (files == variant.watchedFiles) return;
+
+        for (uint64_t subscription : variant.watches) AssetWatcher::instance().unsubscribe(subscription);
+        variant.watches.clear();
+        variant.watchedFiles = files;
+        for (const std::string& file : files)
+        {
+            variant.watches.push_back(AssetWatcher::instance().subscribe(file, [this, key]
+            {
+                const auto it = variants.find(key);
+                if (it == variants.end()) return;
+                it->second.shader->reload();
+                watch(key, it->second);
+            }));
+        }
+    }
+};
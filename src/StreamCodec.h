@@ -0,0 +1,137 @@
+#pragma once
+
+#include "LzCodec.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STREAM_CODEC_SSE2
+#endif
+
+// Lossless codec for vertex and index streams. The stream is read as 32-bit words grouped into
+// elements of stride bytes; every word is replaced by its difference to the same word of the
+// previous element, zig-zag folded so small negative steps stay small, and the bytes are
+// regrouped into four planes (all low bytes first, all high bytes last). Neighbouring vertices
+// and optimized index lists differ by little, so the upper planes come out as long zero runs that
+// the LZ stage removes. Decoding undoes the filter 16 words at a time with SSE2 and only ever
+// writes its output, front to back, so the destination may be a write-combined buffer mapping.
+class StreamCodec
+{
+public:
+    // stride must be a multiple of 4
+    static std::vector<uint8_t> encode(const void* data, size_t count, size_t stride)
+    {
+        const size_t wordCount = count * stride / 4;
+        const size_t period = stride / 4;
+        const auto* bytes = static_cast<const uint8_t*>(data);
+
+        std::vector<uint8_t> planes(wordCount * 4);
+        for (size_t i = 0; i < wordCount; i++)
+        {
+            const uint32_t word = load(bytes + i * 4);
+            const uint32_t previous = i >= period ? load(bytes + (i - period) * 4) : 0;
+            const uint32_t delta = word - previous;
+            const uint32_t folded = (delta << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(delta) >> 31);
+            for (size_t k = 0; k < 4; k++)
+            {
+                planes[k * wordCount + i] = static_cast<uint8_t>(folded >> (8 * k));
+            }
+        }
+        return LzCodec::compress(planes.data(), planes.size());
+    }
+
+    // Fails on a corrupt stream; out is then left partly written
+    static bool decode(const uint8_t* encoded, size_t encodedSize, void* out, size_t count, size_t stride)
+    {
+        const size_t wordCount = count * stride / 4;
+        const size_t period = stride / 4;
+        if (period == 0 || period > MAX_PERIOD) return false;
+
+        thread_local std::vector<uint8_t> planes;
+        planes.resize(wordCount * 4);
+        if (!LzCodec::decompress(encoded, encodedSize, planes.data(), planes.size())) return false;
+
+        const uint8_t* p0 = planes.data();
+        const uint8_t* p1 = p0 + wordCount;
+        const uint8_t* p2 = p1 + wordCount;
+        const uint8_t* p3 = p2 + wordCount;
+        auto* words = static_cast<uint8_t*>(out);
+
+        // The previous element is carried along instead of being read back from out
+        uint32_t previous[MAX_PERIOD] = {};
+        size_t i = 0;
+#ifdef STREAM_CODEC_SSE2
+        if (period == 1 || period % 4 == 0)
+        {
+            __m128i carry[MAX_PERIOD / 4] = {};
+            __m128i last = _mm_setzero_si128();
+            const __m128i one = _mm_set1_epi32(1);
+            for (; i + 16 <= wordCount; i += 16)
+            {
+                const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p0 + i));
+                const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p1 + i));
+                const __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p2 + i));
+                const __m128i b3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p3 + i));
+                const __m128i low01 = _mm_unpacklo_epi8(b0, b1), high01 = _mm_unpackhi_epi8(b0, b1);
+                const __m128i low23 = _mm_unpacklo_epi8(b2, b3), high23 = _mm_unpackhi_epi8(b2, b3);
+                __m128i block[4] = {
+                    _mm_unpacklo_epi16(low01, low23), _mm_unpackhi_epi16(low01, low23),
+                    _mm_unpacklo_epi16(high01, high23), _mm_unpackhi_epi16(high01, high23) };
+
+                for (size_t j = 0; j < 4; j++)
+                {
+                    // Zig-zag: (v >> 1) ^ -(v & 1)
+                    const __m128i folded = block[j];
+                    __m128i delta = _mm_xor_si128(_mm_srli_epi32(folded, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(folded, one)));
+                    if (period == 1)
+                    {
+                        // Running sum within the vector, then the last word of the one before
+                        delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 4));
+                        delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 8));
+                        last = _mm_add_epi32(delta, _mm_shuffle_epi32(last, _MM_SHUFFLE(3, 3, 3, 3)));
+                        block[j] = last;
+                    }
+                    else
+                    {
+                        __m128i& previousWords = carry[((i + j * 4) % period) / 4];
+                        previousWords = _mm_add_epi32(delta, previousWords);
+                        block[j] = previousWords;
+                    }
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(words + (i + j * 4) * 4), block[j]);
+                }
+            }
+            if (period == 1)
+            {
+                previous[0] = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_shuffle_epi32(last, _MM_SHUFFLE(3, 3, 3, 3))));
+            }
+            else
+            {
+                for (size_t g = 0; g < period / 4; g++) _mm_storeu_si128(reinterpret_cast<__m128i*>(previous + g * 4), carry[g]);
+            }
+        }
+#endif
+        for (; i < wordCount; i++)
+        {
+            const uint32_t folded = p0[i] | (static_cast<uint32_t>(p1[i]) << 8) | (static_cast<uint32_t>(p2[i]) << 16) | (static_cast<uint32_t>(p3[i]) << 24);
+            const uint32_t delta = (folded >> 1) ^ (0u - (folded & 1));
+            uint32_t& word = previous[i % period];
+            word += delta;
+            std::memcpy(words + i * 4, &word, 4);
+        }
+        return true;
+    }
+
+private:
+    static constexpr size_t MAX_PERIOD = 64; // words per element
+
+    static uint32_t load(const uint8_t* p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+};
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "AssetHash.h"
+#include "AssetWatcher.h"
+#include "TextureLoader.h"
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Process-wide registry of 2D textures shared by every Model. Textures are looked up by normalized
+// path and gamma first (gamma-corrected textures are uploaded in sRGB formats, so they cannot be shared
+// with linear ones). A new path gets its own GL name right away, and TextureLoader hashes the file
+// on its worker while decoding it; when the hash shows the same image under another path (or copied
+// next to another model) with the same gamma, the newcomer is merged into the existing texture and
+// never uploaded. Holders of the merged name move over through resolve(), see merges().
+// Every acquire() must be paired with a release(); the GL texture goes away with the last one.
+// Edited image files are reloaded into the same GL texture through AssetWatcher.
+class TextureCache
+{
+public:
+    static TextureCache& instance()
+    {
+        static TextureCache cache;
+        return cache;
+    }
+
+    GLuint acquire(const std::string& filename, bool gamma = false)
+    {
+        const std::string key = pathKey(normalizePath(filename), gamma);
+        if (const auto path = idByPath.find(key); path != idByPath.end())
+        {
+            Entry& entry = entries.at(path->second);
+            entry.refs++;
+            return entry.id;
+        }
+
+        // Unreadable files still get an entry (keyed on their path), so repeated misses stay cheap
+        const GLuint id = TextureLoader::instance().load(filename, gamma);
+        Entry& entry = entries[id];
+        entry.id = id;
+        entry.refs = 1;
+        entry.gamma = gamma;
+        entry.keys.push_back(key);
+        entry.files.push_back(filename);
+        idByPath[key] = id;
+        watch(entry, filename);
+        return id;
+    }
+
+    void release(GLuint textureID)
+    {
+        textureID = resolve(textureID);
+        const auto entry = entries.find(textureID);
+        if (entry == entries.end() || --entry->second.refs > 0) return;
+
+        for (const std::string& key : entry->second.keys)
+        {
+            idByPath.erase(key);
+        }
+        if (entry->second.hashed)
+        {
+            const auto content = idByContent.find(entry->second.contentKey);
+            if (content != idByContent.end() && content->second == textureID) idByContent.erase(content);
+        }
+        for (uint64_t subscription : entry->second.subscriptions)
+        {
+            AssetWatcher::instance().unsubscribe(subscription);
+        }
+        TextureLoader::instance().cancel(textureID);
+        glDeleteTextures(1, &textureID);
+        entries.erase(entry);
+    }
+
+    // The name a holder should use instead of textureID, which differs once textureID has been merged
+    // into another texture. Each reference to a merged name is handed over once, through either this
+    // or release(); the merged name is deleted when none is left, so GL cannot reuse it in the meantime.
+    GLuint resolve(GLuint textureID)
+    {
+        const auto forward = forwards.find(textureID);
+        if (forward == forwards.end()) return textureID;
+
+        const GLuint target = forward->second.target;
+        if (--forward->second.holders == 0)
+        {
+            glDeleteTextures(1, &textureID);
+            forwards.erase(forward);
+        }
+        return target;
+    }
+
+    // Bumped by every merge; holders compare it with the last value they saw before calling resolve()
+    uint64_t merges() const { return mergeCount; }
+
+    size_t size() const { return entries.size(); }
+
+    static std::string normalizePath(const std::string& filename)
+    {
+        return std::filesystem::path(filename).lexically_normal().generic_string();
+    }
+
+private:
+    struct Entry
+    {
+        GLuint id = 0;
+        size_t refs = 0;
+        bool gamma = false;
+        bool hashed = false;             // contentKey is known
+        uint64_t contentKey = 0;         // content hash mixed with gamma
+        std::vector<std::string> keys;   // every path key that resolves to this texture
+        std::vector<std::string> files;  // the same paths as given to acquire(), for reloads
+        std::vector<uint64_t> subscriptions;
+    };
+
+    // A merged GL name, kept until every reference to it has moved to target
+    struct Forward
+    {
+        GLuint target = 0;
+        size_t holders = 0;
+    };
+
+    std::unordered_map<std::string, GLuint> idByPath;
+    std::unordered_map<uint64_t, GLuint> idByContent;
+    std::unordered_map<GLuint, Entry> entries;
+    std::unordered_map<GLuint, Forward> forwards;
+    uint64_t mergeCount = 0;
+
+    TextureCache()
+    {
+        TextureLoader::instance().setHashListener([this](GLuint id, uint64_t contentHash) { return hashed(id, contentHash); });
+    }
+
+    static std::string pathKey(const std::string& normalizedPath, bool gamma)
+    {
+        return normalizedPath + (gamma ? "|srgb" : "|linear");
+    }
+
+    static uint64_t contentKey(uint64_t contentHash, bool gamma)
+    {
+        const uint8_t flag = gamma ? 1 : 0;
+        return hashBytes(&flag, sizeof(flag), contentHash);
+    }
+
+    // Edits to any of the paths land in the shared GL texture
+    void watch(Entry& entry, const std::string& filename)
+    {
+        entry.subscriptions.push_back(AssetWatcher::instance().subscribe(filename, [id = entry.id, filename, gamma = entry.gamma]
+        {
+            TextureLoader::instance().reload(id, filename, gamma);
+        }));
+    }
+
+    // From TextureLoader::update, before the image uploads; false skips the upload
+    bool hashed(GLuint id, uint64_t contentHash)
+    {
+        const auto found = entries.find(id);
+        if (found == entries.end()) return true; // not loaded through the cache
+        Entry& entry = found->second;
+        const uint64_t content = contentKey(contentHash, entry.gamma);
+
+        // Reloaded after an edit: only the content key moves, the texture stays separate
+        if (entry.hashed)
+        {
+            if (content == entry.contentKey) return true;
+            if (const auto previous = idByContent.find(entry.contentKey); previous != idByContent.end() && previous->second == id) idByContent.erase(previous);
+            entry.contentKey = content;
+            idByContent.try_emplace(content, id);
+            return true;
+        }
+
+        entry.hashed = true;
+        entry.contentKey = content;
+        const auto [existing, inserted] = idByContent.try_emplace(content, id);
+        if (inserted) return true;
+
+        // Same image as an existing texture: its paths and references move over
+        Entry& target = entries.at(existing->second);
+        target.refs += entry.refs;
+        for (const std::string& key : entry.keys)
+        {
+            idByPath[key] = target.id;
+            target.keys.push_back(key);
+        }
+        for (uint64_t subscription : entry.subscriptions)
+        {
+            AssetWatcher::instance().unsubscribe(subscription);
+        }
+        for (const std::string& file : entry.files)
+        {
+            target.files.push_back(file);
+            watch(target, file);
+        }
+        forwards[id] = { target.id, entry.refs };
+        TextureLoader::instance().cancel(id);
+        entries.erase(found);
+        mergeCount++;
+        return false;
+    }
+};
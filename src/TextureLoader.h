@@ -0,0 +1,362 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include "AssetHash.h"
+#include "CookedTexture.h"
+#include "ThreadPool.h"
+#include "VirtualFileSystem.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Streams 2D textures in the background: images are decoded on the worker pool and
+// uploaded through a pixel-buffer object from update(), which runs on the GL thread.
+// load() hands out the GL name right away with a 1x1 placeholder bound to it.
+// Textures cooked by the asset cooker skip the decode and come block compressed with their mip chain.
+class TextureLoader
+{
+public:
+    // Upload budget per update() call, so a burst of finished decodes does not stall a frame
+    static constexpr size_t DEFAULT_UPLOAD_BUDGET = 64 * 1024 * 1024;
+
+    // Called on the GL thread with the content hash of every readable image before it uploads;
+    // returning false drops the upload. Lets TextureCache find duplicates without reading files itself.
+    using HashListener = std::function<bool(GLuint textureID, uint64_t contentHash)>;
+
+    static TextureLoader& instance()
+    {
+        static TextureLoader loader;
+        return loader;
+    }
+
+    ~TextureLoader()
+    {
+        // Decode tasks report back into this object, so let the in-flight ones land first
+        std::unique_lock<std::mutex> lock(mutex);
+        decodeDone.wait(lock, [this] { return inFlight == 0; });
+        for (DecodedImage& image : decoded)
+        {
+            stbi_image_free(image.pixels);
+        }
+    }
+
+    GLuint load(const std::string& filename, bool gamma = false)
+    {
+        return load(filename, FileData(), gamma);
+    }
+
+    // Decodes from an already opened file when one is given, instead of reading it again
+    GLuint load(const std::string& filename, FileData source, bool gamma = false)
+    {
+        queryCompressionSupport();
+        GLuint textureID;
+        glGenTextures(1, &textureID);
+        bindPlaceholder(textureID);
+        queue(textureID, filename, std::move(source), gamma, false);
+        return textureID;
+    }
+
+    // Reads a changed image into its existing GL name; the old image stays bound until the new one
+    // uploads. A texture the asset cooker had cooked is cooked again first, with the cooker's defaults.
+    void reload(GLuint textureID, const std::string& filename, bool gamma = false)
+    {
+        queue(textureID, filename, FileData(), gamma, true);
+    }
+
+    // Forgets a texture that is about to be deleted: drops its pending upload, if the decode has
+    // not finished yet, and its share of gpuBytes()
+    void cancel(GLuint textureID)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tickets.erase(textureID);
+        }
+        if (const auto bytes = textureBytes.find(textureID); bytes != textureBytes.end())
+        {
+            totalTextureBytes -= bytes->second;
+            textureBytes.erase(bytes);
+        }
+    }
+
+    void setHashListener(HashListener listener)
+    {
+        hashListener = std::move(listener);
+    }
+
+    // Uploads finished decodes. Call once per frame on the GL thread.
+    void update(size_t uploadBudget = DEFAULT_UPLOAD_BUDGET)
+    {
+        size_t uploaded = 0;
+        while (uploaded < uploadBudget)
+        {
+            DecodedImage image;
+            bool current;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (decoded.empty()) break;
+                image = decoded.front();
+                decoded.pop_front();
+
+                // GL names get reused, so only the latest load of a name may upload into it
+                const auto ticket = tickets.find(image.id);
+                current = ticket != tickets.end() && ticket->second == image.ticket;
+                if (current) tickets.erase(ticket);
+            }
+            if (current && image.hashed && hashListener && !hashListener(image.id, image.contentHash))
+            {
+                stbi_image_free(image.pixels);
+            }
+            else if (current)
+            {
+                // Decoded images get their mip chain from glGenerateMipmap, about a third on top of the base level
+                const size_t size = upload(image);
+                const size_t resident = image.cooked ? size : size + size / 3;
+                uploaded += size;
+                totalTextureBytes += resident - std::exchange(textureBytes[image.id], resident);
+            }
+            else
+            {
+                stbi_image_free(image.pixels);
+            }
+        }
+    }
+
+    // Blocks until every requested texture has been decoded and uploaded
+    void finish()
+    {
+        while (pending() > 0)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                decodeDone.wait(lock, [this] { return inFlight == 0 || !decoded.empty(); });
+            }
+            update(SIZE_MAX);
+        }
+    }
+
+    // Approximate video memory of every uploaded texture, placeholders excluded. GL thread only.
+    size_t gpuBytes() const { return totalTextureBytes; }
+
+    size_t pending()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return inFlight + decoded.size();
+    }
+
+    // Call on the GL thread before supports() is used; load() does it before the first decode is queued
+    void queryCompressionSupport()
+    {
+        if (supportQueried) return;
+        supportQueried = true;
+
+        GLint extensionCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+        for (GLint i = 0; i < extensionCount; i++)
+        {
+            const auto* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+            if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) s3tcSupported = true;
+            if (name && std::strcmp(name, "GL_EXT_texture_sRGB") == 0) s3tcSrgbSupported = true;
+        }
+    }
+
+    // Whether cooked data in this format can be uploaded as it is. S3TC is an extension on desktop GL, and
+    // its sRGB variants another one; without them cooked BC1/BC3 textures are skipped and the source
+    // image is decoded instead.
+    bool supports(TextureFormat format, bool srgb = false) const
+    {
+        if (format != TextureFormat::BC1 && format != TextureFormat::BC3) return true;
+        return s3tcSupported && (!srgb || s3tcSrgbSupported);
+    }
+
+    // Specifies one level of the bound texture target from client memory or the bound unpack buffer.
+    // srgb picks the sRGB variant of the format where there is one, so sampling returns linear values.
+    static void specifyLevel(GLenum target, GLint level, TextureFormat format, uint32_t width, uint32_t height, size_t size, const void* data, bool srgb)
+    {
+        const TextureFormatInfo& info = textureFormatInfo(format);
+        const bool useSrgb = srgb && info.srgbInternalFormat != 0;
+        if (info.compressed)
+        {
+            glCompressedTexImage2D(target, level, useSrgb ? info.srgbInternalFormat : info.internalFormat, static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, static_cast<GLsizei>(size), data);
+        }
+        else
+        {
+            // Like before cooking, the internal format follows the image's channel count
+            const GLenum internalFormat = useSrgb ? info.srgbInternalFormat : info.pixelFormat;
+            glTexImage2D(target, level, static_cast<GLint>(internalFormat), static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, info.pixelFormat, GL_UNSIGNED_BYTE, data);
+        }
+    }
+
+    // Fills one whole level of storage allocated with glTexStorage2D; srgb must match the storage's format
+    static void fillLevel(GLenum target, GLint level, TextureFormat format, uint32_t width, uint32_t height, size_t size, const void* data, bool srgb)
+    {
+        const TextureFormatInfo& info = textureFormatInfo(format);
+        if (info.compressed)
+        {
+            const GLenum internalFormat = srgb && info.srgbInternalFormat != 0 ? info.srgbInternalFormat : info.internalFormat;
+            glCompressedTexSubImage2D(target, level, 0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height), internalFormat, static_cast<GLsizei>(size), data);
+        }
+        else
+        {
+            glTexSubImage2D(target, level, 0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height), info.pixelFormat, GL_UNSIGNED_BYTE, data);
+        }
+    }
+
+private:
+    struct DecodedImage
+    {
+        GLuint id = 0;
+        uint64_t ticket = 0;
+        std::string filename;
+        bool gamma = false;
+        int width = 0, height = 0, channels = 0;
+        unsigned char* pixels = nullptr;
+        std::shared_ptr<const CookedTexture> cooked; // KTX2 mip chain from the asset cooker, used instead of pixels
+        uint64_t contentHash = 0; // hashBytes of the source file, valid when hashed
+        bool hashed = false;
+    };
+
+    std::mutex mutex;
+    std::condition_variable decodeDone;
+    std::deque<DecodedImage> decoded;
+    std::unordered_map<GLuint, uint64_t> tickets;
+    uint64_t lastTicket = 0;
+    size_t inFlight = 0;
+    std::unordered_map<GLuint, size_t> textureBytes; // GL thread only
+    size_t totalTextureBytes = 0;
+    GLuint pbo = 0;
+    HashListener hashListener;
+    std::atomic<bool> s3tcSupported = false;
+    std::atomic<bool> s3tcSrgbSupported = false;
+    bool supportQueried = false;
+
+    TextureLoader() = default;
+
+    void queue(GLuint textureID, const std::string& filename, FileData source, bool gamma, bool recook)
+    {
+        uint64_t ticket;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            inFlight++;
+            ticket = ++lastTicket;
+            tickets[textureID] = ticket;
+        }
+        ThreadPool::shared().submit([this, textureID, ticket, filename, source, gamma, recook]
+        {
+            DecodedImage image{ textureID, ticket, filename, gamma };
+            if (recook && std::filesystem::exists(CookedTexture::cachePathFor(filename)))
+            {
+                CookedTexture::cook(filename, true);
+            }
+
+            // Cooked textures carry the hash of their source, so only decoded images hash the file here
+            auto cooked = std::make_shared<CookedTexture>();
+            if (cooked->open(filename) && supports(cooked->format(), gamma))
+            {
+                image.contentHash = cooked->sourceHash();
+                image.hashed = true;
+                image.cooked = std::move(cooked);
+            }
+            else
+            {
+                const FileData file = source.isOpen() ? source : VirtualFileSystem::instance().open(filename);
+                if (file.isOpen())
+                {
+                    image.contentHash = hashBytes(file.data(), file.size());
+                    image.hashed = true;
+                    image.pixels = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &image.width, &image.height, &image.channels, 0);
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            decoded.push_back(image);
+            inFlight--;
+            decodeDone.notify_all();
+        });
+    }
+
+    static void bindPlaceholder(GLuint textureID)
+    {
+        static constexpr unsigned char white[4] = { 255, 255, 255, 255 };
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+
+    size_t upload(const DecodedImage& image)
+    {
+        if (image.pixels == nullptr && !image.cooked)
+        {
+            std::cout << "Failed to load texture!\nat path: " << image.filename << std::endl;
+            return 0;
+        }
+
+        // One staging area for every level: the cooked mip chain, or the decoded base level
+        const TextureFormat format = image.cooked ? image.cooked->format() : BlockCompression::uncompressedFormat(image.channels);
+        const uint32_t levelCount = image.cooked ? image.cooked->levelCount() : 1;
+        std::vector<size_t> offsets;
+        size_t size = 0;
+        for (uint32_t level = 0; level < levelCount; level++)
+        {
+            offsets.push_back(size);
+            size += image.cooked ? image.cooked->faceSize(level) : static_cast<size_t>(image.width) * image.height * image.channels;
+        }
+
+        // Orphan the PBO on every upload so the driver never has to wait on the previous transfer
+        if (pbo == 0) glGenBuffers(1, &pbo);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+        if (auto* staging = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT)))
+        {
+            for (uint32_t level = 0; level < levelCount; level++)
+            {
+                const uint8_t* source = image.cooked ? image.cooked->faceData(level) : image.pixels;
+                const size_t levelSize = (level + 1 < levelCount ? offsets[level + 1] : size) - offsets[level];
+                std::memcpy(staging + offsets[level], source, levelSize);
+            }
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        stbi_image_free(image.pixels);
+
+        GLint alignment;
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        glBindTexture(GL_TEXTURE_2D, image.id);
+        for (uint32_t level = 0; level < levelCount; level++)
+        {
+            const uint32_t width = image.cooked ? image.cooked->levelWidth(level) : static_cast<uint32_t>(image.width);
+            const uint32_t height = image.cooked ? image.cooked->levelHeight(level) : static_cast<uint32_t>(image.height);
+            const size_t levelSize = (level + 1 < levelCount ? offsets[level + 1] : size) - offsets[level];
+            specifyLevel(GL_TEXTURE_2D, static_cast<GLint>(level), format, width, height, levelSize, reinterpret_cast<const void*>(offsets[level]), image.gamma);
+        }
+        if (image.cooked)
+        {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levelCount - 1));
+        }
+        else
+        {
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return size;
+    }
+};
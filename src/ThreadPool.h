@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed-size worker pool for CPU-side asset work. GL calls never run on it.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t threadCount = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        for (size_t i = 0; i < threadCount; i++)
+        {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Process-wide pool shared by the importers and loaders
+    static ThreadPool& shared()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    size_t size() const { return workers.size(); }
+
+    template <class F>
+    auto submit(F&& function) -> std::future<std::invoke_result_t<F>>
+    {
+        using Result = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(function));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace([task] { (*task)(); });
+        }
+        wakeUp.notify_one();
+        return result;
+    }
+
+    // Runs body(i) for every i in [0, count) and returns once all of them finished.
+    // The calling thread takes part, so nesting it inside a pool task cannot starve the pool.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body)
+    {
+        if (count == 0) return;
+        if (count == 1 || workers.empty())
+        {
+            for (size_t i = 0; i < count; i++) body(i);
+            return;
+        }
+
+        auto next = std::make_shared<std::atomic<size_t>>(0);
+        auto run = [next, count, &body]
+        {
+            for (size_t i = next->fetch_add(1); i < count; i = next->fetch_add(1))
+            {
+                body(i);
+            }
+        };
+
+        std::vector<std::future<void>> helpers;
+        const size_t helperCount = std::min(workers.size(), count - 1);
+        for (size_t i = 0; i < helperCount; i++)
+        {
+            helpers.push_back(submit(run));
+        }
+        run();
+        for (std::future<void>& helper : helpers)
+        {
+            wait(helper);
+        }
+    }
+
+    // Blocks on a future, running queued tasks meanwhile instead of idling
+    template <class T>
+    void wait(std::future<T>& future)
+    {
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            if (!runPendingTask())
+            {
+                future.wait_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping = false;
+
+    bool runPendingTask()
+    {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (tasks.empty()) return false;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+        return true;
+    }
+
+    void workerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeUp.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Fixed binding points of the uniform blocks every program may declare. Shader connects a
+// block to its point by name after each link, since GLSL 330 has no binding layout qualifier.
+struct UniformBlockBinding
+{
+    const char* name;
+    GLuint binding;
+};
+
+constexpr GLuint FRAME_UNIFORM_BINDING = 0;
+constexpr GLuint LIGHT_UNIFORM_BINDING = 1;
+
+constexpr UniformBlockBinding UNIFORM_BLOCKS[] = {
+    { "FrameData", FRAME_UNIFORM_BINDING },
+    { "LightData", LIGHT_UNIFORM_BINDING },
+};
+
+// Buffer behind one std140 block, bound to its binding point for good. T must match the block
+// layout byte for byte. update() replaces the whole contents once per frame; the old storage is
+// orphaned first so the driver never waits for draws that still read the previous frame's data.
+template <typename T>
+class UniformBuffer
+{
+public:
+    explicit UniformBuffer(GLuint binding) : binding(binding)
+    {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+    }
+
+    ~UniformBuffer()
+    {
+        glDeleteBuffers(1, &buffer);
+    }
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    void update(const T& data)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    GLuint getBinding() const { return binding; }
+
+private:
+    GLuint buffer = 0;
+    GLuint binding;
+};
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "ImportSettings.h"
+#include "MeshData.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+struct CompactVertex
+{
+    glm::vec3 position;
+    uint32_t normal;        // signed normalized 10:10:10:2
+    uint16_t texCoords[2];  // half floats
+};
+
+struct QuantizedVertex
+{
+    uint16_t position[4];   // unsigned normalized, w is padding
+    uint32_t normal;
+    uint16_t texCoords[2];
+};
+
+static_assert(sizeof(CompactVertex) == 20, "CompactVertex must stay tightly packed");
+static_assert(sizeof(QuantizedVertex) == 16, "QuantizedVertex must stay tightly packed");
+
+// Conversion of imported Vertex data into the compact GPU layouts
+class VertexPacking
+{
+public:
+    static size_t stride(VertexFormat format)
+    {
+        switch (format)
+        {
+        case VertexFormat::Compact: return sizeof(CompactVertex);
+        case VertexFormat::Quantized: return sizeof(QuantizedVertex);
+        default: return sizeof(Vertex);
+        }
+    }
+
+    // Quantized positions map the mesh bounds onto [0, 1]; the vertex shader undoes it with this transform
+    static glm::vec3 positionScale(VertexFormat format, glm::vec3 boundsMin, glm::vec3 boundsMax)
+    {
+        return format == VertexFormat::Quantized ? boundsMax - boundsMin : glm::vec3(1.0f);
+    }
+
+    static glm::vec3 positionOffset(VertexFormat format, glm::vec3 boundsMin)
+    {
+        return format == VertexFormat::Quantized ? boundsMin : glm::vec3(0.0f);
+    }
+
+    // Picks the narrowest format, no wider than the requested one, that keeps the mesh within the error bounds
+    static VertexFormat choose(const MeshData& mesh, const ImportSettings& settings)
+    {
+        VertexFormat format = settings.vertexFormat;
+        if (format == VertexFormat::Float) return format;
+
+        float normalError = 0.0f, texCoordError = 0.0f, positionError = 0.0f;
+        const glm::vec3 scale = positionScale(VertexFormat::Quantized, mesh.boundsMin, mesh.boundsMax);
+        for (const Vertex& vertex : mesh.vertices)
+        {
+            const glm::vec3 normal = unitNormal(vertex.normal);
+            normalError = std::max(normalError, glm::length(glm::vec3(glm::unpackSnorm3x10_1x2(packNormal(normal))) - normal));
+            for (int k = 0; k < 2; k++)
+            {
+                texCoordError = std::max(texCoordError, std::fabs(glm::unpackHalf1x16(glm::packHalf1x16(vertex.texCoords[k])) - vertex.texCoords[k]));
+            }
+            if (format == VertexFormat::Quantized)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    const float restored = dequantize(quantize(vertex.position[k], mesh.boundsMin[k], scale[k]), mesh.boundsMin[k], scale[k]);
+                    positionError = std::max(positionError, std::fabs(restored - vertex.position[k]));
+                }
+            }
+        }
+
+        if (normalError > settings.maxNormalError || texCoordError > settings.maxTexCoordError) return VertexFormat::Float;
+        const float diagonal = glm::length(mesh.boundsMax - mesh.boundsMin);
+        if (format == VertexFormat::Quantized && positionError > settings.maxPositionError * diagonal) return VertexFormat::Compact;
+        return format;
+    }
+
+    // Writes the vertex data in the given layout, front to back and without reading destination back,
+    // so it may point into a buffer mapping
+    static void packInto(std::span<const Vertex> vertices, VertexFormat format, glm::vec3 boundsMin, glm::vec3 boundsMax, uint8_t* destination)
+    {
+        const glm::vec3 scale = positionScale(format, boundsMin, boundsMax);
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            const Vertex& vertex = vertices[i];
+            if (format == VertexFormat::Compact)
+            {
+                CompactVertex out;
+                out.position = vertex.position;
+                out.normal = packNormal(unitNormal(vertex.normal));
+                out.texCoords[0] = glm::packHalf1x16(vertex.texCoords.x);
+                out.texCoords[1] = glm::packHalf1x16(vertex.texCoords.y);
+                std::memcpy(destination + i * sizeof(out), &out, sizeof(out));
+            }
+            else if (format == VertexFormat::Quantized)
+            {
+                QuantizedVertex out;
+                for (int k = 0; k < 3; k++)
+                {
+                    out.position[k] = quantize(vertex.position[k], boundsMin[k], scale[k]);
+                }
+                out.position[3] = 0;
+                out.normal = packNormal(unitNormal(vertex.normal));
+                out.texCoords[0] = glm::packHalf1x16(vertex.texCoords.x);
+                out.texCoords[1] = glm::packHalf1x16(vertex.texCoords.y);
+                std::memcpy(destination + i * sizeof(out), &out, sizeof(out));
+            }
+            else
+            {
+                std::memcpy(destination + i * sizeof(Vertex), &vertex, sizeof(Vertex));
+            }
+        }
+    }
+
+    // Attribute setup for the currently bound VAO and VBO, matching locations 0-2 of the mesh shaders
+    static void setupAttributes(VertexFormat format)
+    {
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+
+        switch (format)
+        {
+        case VertexFormat::Compact:
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(CompactVertex), reinterpret_cast<void*>(offsetof(CompactVertex, position)));
+            glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(CompactVertex), reinterpret_cast<void*>(offsetof(CompactVertex, normal)));
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(CompactVertex), reinterpret_cast<void*>(offsetof(CompactVertex, texCoords)));
+            break;
+        case VertexFormat::Quantized:
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex), reinterpret_cast<void*>(offsetof(QuantizedVertex, position)));
+            glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(QuantizedVertex), reinterpret_cast<void*>(offsetof(QuantizedVertex, normal)));
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(QuantizedVertex), reinterpret_cast<void*>(offsetof(QuantizedVertex, texCoords)));
+            break;
+        default:
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, position)));
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, normal)));
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, texCoords)));
+            break;
+        }
+    }
+
+private:
+    static glm::vec3 unitNormal(const glm::vec3& normal)
+    {
+        const float length = glm::length(normal);
+        return length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+
+    static uint32_t packNormal(const glm::vec3& normal)
+    {
+        return glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+    }
+
+    static uint16_t quantize(float value, float minimum, float extent)
+    {
+        if (extent <= 0.0f) return 0;
+        const float normalized = std::clamp((value - minimum) / extent, 0.0f, 1.0f);
+        return static_cast<uint16_t>(std::lround(normalized * 65535.0f));
+    }
+
+    static float dequantize(uint16_t value, float minimum, float extent)
+    {
+        return minimum + static_cast<float>(value) / 65535.0f * extent;
+    }
+};
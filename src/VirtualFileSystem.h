@@ -0,0 +1,201 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+
+#include "AssetHash.h"
+#include "MappedFile.h"
+#include "Pak.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+// The bytes of one file, wherever they came from: a slice of a mounted package, a decompressed
+// copy of a compressed entry, or a mapping of a loose file. Copies share the storage, which
+// stays alive as long as any of them does.
+class FileData
+{
+public:
+    bool isOpen() const { return bytes != nullptr; }
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+    std::string_view text() const { return { reinterpret_cast<const char*>(bytes), length }; }
+
+    // Shares a mapping that is already open
+    static FileData fromMapping(std::shared_ptr<const MappedFile> file)
+    {
+        FileData data;
+        if (!file || !file->isOpen()) return data;
+        data.bytes = file->data();
+        data.length = file->size();
+        data.owner = std::move(file);
+        return data;
+    }
+
+private:
+    friend class VirtualFileSystem;
+
+    std::shared_ptr<const void> owner;
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+};
+
+// Single entry point for asset reads. Paths are looked up in the mounted packages first, the
+// most recently mounted one winning, and fall back to loose files, so a shipped build opens one
+// file at start-up while a working copy without a package reads res/ directly. A package
+// shadows the loose files it contains, edits to them included. Thread-safe.
+class VirtualFileSystem
+{
+public:
+    static VirtualFileSystem& instance()
+    {
+        static VirtualFileSystem fileSystem;
+        return fileSystem;
+    }
+
+    bool mount(const std::string& pakPath)
+    {
+        auto pak = std::make_shared<Pak>(pakPath);
+        if (!pak->isOpen())
+        {
+            std::cout << "ERROR::VFS::CANNOT_MOUNT " << pakPath << std::endl;
+            return false;
+        }
+        spdlog::info("Mounted {}: {} entries, {:.1f} MB", pakPath, pak->size(), static_cast<double>(pak->fileSize()) / (1024.0 * 1024.0));
+
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        paks.insert(paks.begin(), std::move(pak));
+        return true;
+    }
+
+    void unmountAll()
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        paks.clear();
+    }
+
+    bool hasMounts() const
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return !paks.empty();
+    }
+
+    FileData open(const std::string& path) const
+    {
+        FileData data = openPacked(path);
+        if (data.isOpen()) return data;
+
+        return FileData::fromMapping(std::make_shared<MappedFile>(path));
+    }
+
+    // Only looks into the mounted packages
+    FileData openPacked(const std::string& path) const
+    {
+        FileData data;
+        std::shared_ptr<const Pak> pak;
+        const PakEntry* entry = find(path, pak);
+        if (entry == nullptr) return data;
+
+        if (entry->flags & PAK_ENTRY_COMPRESSED)
+        {
+            auto buffer = std::make_shared<std::vector<uint8_t>>(entry->size);
+            if (!pak->extract(*entry, buffer->data()))
+            {
+                std::cout << "ERROR::VFS::CORRUPT_ENTRY " << path << std::endl;
+                return data;
+            }
+            data.bytes = buffer->data();
+            data.length = buffer->size();
+            data.owner = std::move(buffer);
+        }
+        else
+        {
+            data.bytes = pak->storedData(*entry);
+            data.length = entry->size;
+            data.owner = std::move(pak);
+        }
+        return data;
+    }
+
+    bool exists(const std::string& path) const
+    {
+        std::shared_ptr<const Pak> pak;
+        if (find(path, pak) != nullptr) return true;
+        std::error_code ec;
+        return std::filesystem::is_regular_file(path, ec);
+    }
+
+    bool readText(const std::string& path, std::string& text) const
+    {
+        const FileData data = open(path);
+        if (!data.isOpen()) return false;
+        text.assign(data.text());
+        return true;
+    }
+
+    // SourceStamp::capture() for a file that may be packed. Packed files carry no mtime.
+    bool captureStamp(const std::string& path, SourceStamp& stamp) const
+    {
+        std::shared_ptr<const Pak> pak;
+        if (const PakEntry* entry = find(path, pak))
+        {
+            stamp = { entry->size, 0, entry->contentHash };
+            return true;
+        }
+        return SourceStamp::capture(path, stamp);
+    }
+
+    // SourceStamp::matches() for a file that may be packed, where the index holds the content hash
+    bool stampMatches(const SourceStamp& stamp, const std::string& path, bool& touched) const
+    {
+        std::shared_ptr<const Pak> pak;
+        if (const PakEntry* entry = find(path, pak))
+        {
+            touched = false;
+            return entry->size == stamp.size && entry->contentHash == stamp.hash;
+        }
+        return stamp.matches(path, touched);
+    }
+
+    // Relative to the working directory with "." and ".." folded, the form package paths are stored in
+    static std::string normalize(const std::string& path)
+    {
+        std::filesystem::path result(path);
+        if (result.is_absolute())
+        {
+            std::error_code ec;
+            const auto relative = result.lexically_relative(std::filesystem::current_path(ec));
+            if (!ec && !relative.empty()) result = relative;
+        }
+        return result.lexically_normal().generic_string();
+    }
+
+private:
+    mutable std::shared_mutex mutex;
+    std::vector<std::shared_ptr<const Pak>> paks; // most recently mounted first
+
+    VirtualFileSystem() = default;
+
+    const PakEntry* find(const std::string& path, std::shared_ptr<const Pak>& owner) const
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        if (paks.empty()) return nullptr;
+        const std::string key = normalize(path);
+        for (const auto& pak : paks)
+        {
+            if (const PakEntry* entry = pak->find(key))
+            {
+                owner = pak;
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+};
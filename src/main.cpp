@@ -12,6 +12,9 @@
 #include "PointLight.h"
 #include "SpotLight.h"
 #include "LightPosition.h"
+#include "SceneUniforms.h"
+#include "ShaderVariants.h"
+#include "UniformBuffer.h"
 
 #define IMGUI_IMPL_OPENGL_LOADER_GLAD
 
@@ -28,7 +31,11 @@
 #include <GLFW/glfw3.h> // Include glfw3.h after our OpenGL definitions
 #include <spdlog/spdlog.h>
 
-GLuint loadCubemapTexture(std::vector<std::string> faces);
+#include <chrono>
+#include <filesystem>
+#include <memory>
+
+GLuint loadCubemapTexture(const std::vector<std::string>& faces, bool generateMipmaps = false);
 
 static void glfw_error_callback(int err, const char* description)
 {
@@ -38,6 +45,25 @@ static void glfw_error_callback(int err, const char* description)
 constexpr int WINDOW_WIDTH = 1600;
 constexpr int WINDOW_HEIGHT = 900;
 
+// Memory for models and textures; the least recently drawn ones are evicted above it
+constexpr size_t RESIDENCY_BUDGET = 512 * 1024 * 1024;
+
+// Built by the asset cooker with --pak; without it assets are read from res/ directly
+constexpr const char* ASSET_PACKAGE = "res.pak";
+
+// Uniforms the per-frame code sets, looked up once; the handles survive shader hot reloads.
+// Camera and light data come from the shared uniform buffers instead.
+struct ProgramUniforms
+{
+    UniformHandle shininess, skybox;
+    DrawUniforms draw; // handed to the scene graph, which sets model and the per-mesh uniforms
+
+    explicit ProgramUniforms(Shader& shader)
+        : shininess(shader.uniform("material.shininess")), skybox(shader.uniform("skybox")), draw(shader)
+    {
+    }
+};
+
 // Camera setup
 Camera cam(glm::vec3(0.0f, 30.0f, 25.0f), WINDOW_WIDTH, WINDOW_HEIGHT);
 float camX = WINDOW_WIDTH * 0.5;
@@ -67,10 +93,10 @@ int main(int, char**)
 
     // Decide GL+GLSL versions
 #if __APPLE__
-    // GL 3.2 + GLSL 150
-    const char* glsl_version = "#version 150";
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+    // GL 4.1 + GLSL 410, the newest macOS offers; needed for glProgramBinary
+    const char* glsl_version = "#version 410";
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);  // 3.2+ only
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);            // Required on Mac
 #else
@@ -102,6 +128,7 @@ int main(int, char**)
         return 1;
     }
     spdlog::info("Successfully initialized OpenGL loader!");
+    Shader::enableParallelCompile(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
 
     // Setup Dear ImGui binding
     IMGUI_CHECKVERSION();
@@ -116,12 +143,29 @@ int main(int, char**)
     constexpr ImVec4 clear_color = ImVec4(0.11f, 0.11f, 0.22f, 1.0f);//(0.11f, 0.11f, 0.11f, 1.00f);
     
         
+    if (std::filesystem::exists(ASSET_PACKAGE)) VirtualFileSystem::instance().mount(ASSET_PACKAGE);
+
     // SHADER SETUP //
     //Shader shaderProgram("res/shaders/basic.vert", "res/shaders/basic.frag");
-    Shader shaderLit("res/shaders/lit.vert", "res/shaders/lit.frag");
-    Shader shaderInstance("res/shaders/instance.vert", "res/shaders/instance.frag");
-    Shader shaderSkybox("res/shaders/skybox.vert", "res/shaders/skybox.frag");
-    Shader shaderRefraction("../../res/shaders/refraction.vert", "../../res/shaders/refraction.frag");
+    // Every program is submitted up front and compiles while the scene loads; until one is ready
+    // its meshes are drawn with the fallback program. Light array sizes come from SceneUniforms.h.
+    ShaderVariants& shaderVariants = ShaderVariants::instance();
+    const ShaderDefines lightDefines = ShaderDefines().set("NR_POINT_LIGHTS", MAX_POINT_LIGHTS).set("NR_SPOT_LIGHTS", MAX_SPOT_LIGHTS);
+    Shader& shaderLit = shaderVariants.get({ "res/shaders/lit.vert", "res/shaders/lit.frag" }, ShaderDefines(lightDefines).set("SKYBOX_REFLECTIONS"));
+    Shader& shaderInstance = shaderVariants.get({ "res/shaders/instance.vert", "res/shaders/lit.frag" }, lightDefines);
+    Shader& shaderSkybox = shaderVariants.get({ "res/shaders/skybox.vert", "res/shaders/skybox.frag" });
+    Shader& shaderRefraction = shaderVariants.get({ "res/shaders/refraction.vert", "res/shaders/refraction.frag" });
+    const ProgramUniforms litUniforms(shaderLit);
+    const ProgramUniforms instanceUniforms(shaderInstance);
+    const ProgramUniforms refractionUniforms(shaderRefraction);
+
+    // Per-frame data shared by every program through fixed binding points, released with the models below
+    auto frameUniforms = std::make_unique<UniformBuffer<FrameUniforms>>(FRAME_UNIFORM_BINDING);
+    auto lightUniforms = std::make_unique<UniformBuffer<LightUniforms>>(LIGHT_UNIFORM_BINDING);
+
+    // Hot reload: edited shaders are rebuilt between frames (ShaderVariants watches them, includes too);
+    // models and textures watch their own files. A mounted package shadows res/, so edits there would never be seen.
+    if (!VirtualFileSystem::instance().hasMounts()) AssetWatcher::instance().start("res");
 
     // SKYBOX SETUP //
     float skyboxVertices[] = {      
@@ -170,12 +214,12 @@ int main(int, char**)
 
 	std::vector<std::string> faces =
     {
-        "../../res/textures/skybox/right.jpg",
-        "../../res/textures/skybox/left.jpg",
-        "../../res/textures/skybox/top.jpg",
-        "../../res/textures/skybox/bottom.jpg",
-        "../../res/textures/skybox/front.jpg",
-        "../../res/textures/skybox/back.jpg"
+        "res/textures/skybox/right.jpg",
+        "res/textures/skybox/left.jpg",
+        "res/textures/skybox/top.jpg",
+        "res/textures/skybox/bottom.jpg",
+        "res/textures/skybox/front.jpg",
+        "res/textures/skybox/back.jpg"
     };
 
     GLuint cubemap = loadCubemapTexture(faces);
@@ -190,15 +234,14 @@ int main(int, char**)
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), static_cast<void*>(nullptr));
 
-    shaderSkybox.use();
-    shaderSkybox.setInt("skybox", 0);
-
     // load models
+    ResidencyManager::instance().setBudget(RESIDENCY_BUDGET);
     //Model loadedModel("res/models/sword.obj");
-    Model loadedModel("res/models/char/Walking.dae");
+    // Owned through a pointer so its GL resources are released while the context still exists
+    auto loadedModel = std::make_unique<Model>("res/models/char/Walking.dae");
 
     // Scene root object (SceneGraph Node)
-    Node root(&loadedModel);
+    Node root(loadedModel.get());
 
     // WATCH OUT! If something will be translated unproperly in the future it might be because of
     // a model being a root itself... Maybe another "model" should be a root?
@@ -217,7 +260,7 @@ int main(int, char**)
     root.addChild(&dirLightPosition);
 
     // Model
-    Node mainModel(&loadedModel);
+    Node mainModel(loadedModel.get());
     root.addChild(&mainModel);
 
     glm::mat4 mainModelTransform = glm::mat4(1.0f);
@@ -243,6 +286,13 @@ int main(int, char**)
         // Poll and handle events (inputs, window resize, etc.)
         glfwPollEvents();
 
+        // Apply edits to watched assets, then upload textures whose background decode finished since the last frame
+        AssetWatcher::instance().update();
+        TextureLoader::instance().update();
+
+        // Switch to programs whose (re)build the driver finished since the last frame
+        shaderVariants.poll();
+
         // Start the Dear ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -270,6 +320,9 @@ int main(int, char**)
 
             ImGui::Text("Performance");
             ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+            const ResidencyManager& residency = ResidencyManager::instance();
+            ImGui::Text("Resident %zu/%zu models, %.1f of %.1f MB", residency.residentCount(), residency.size(),
+                ResidencyManager::megabytes(residency.usedBytes()), ResidencyManager::megabytes(residency.getBudget()));
 
             ImGui::End();
         }
@@ -286,53 +339,31 @@ int main(int, char**)
 
         cam.Inputs(window);
 
-        // Setting lit shader uniforms
-        shaderInstance.use();
-        {
-            shaderInstance.setVec3("viewPos", cam.position);
-            shaderInstance.setFloat("material.shininess", 32.0f);
-
-            // We set all the uniforms for the types of lights we have. 
-            // We have to set them manually and index the proper struct in the array 
-            // to set each uniform variable.
-
-            //Directional light
-            shaderInstance.setBool("dirLight.enabled", enableDirectional);
-            shaderInstance.setVec3("dirLight.direction", directionalLight.direction);
-            shaderInstance.setVec3("dirLight.ambient", directionalLight.ambient);
-            shaderInstance.setVec3("dirLight.diffuse", directionalLight.diffuse);
-            shaderInstance.setVec3("dirLight.specular", directionalLight.specular);
-        }
-
         // view/projection transform
         glm::mat4 projection = glm::perspective(glm::radians(cam.zoom), static_cast<float>(WINDOW_WIDTH) / static_cast<float>(WINDOW_HEIGHT), 0.1f, 2000.0f);
         glm::mat4 view = cam.getViewMatrix();
-        shaderInstance.setMat4("projection", projection);
-        shaderInstance.setMat4("view", view);
+        LodSelector::setView(cam.position, projection);
+
+        // Camera and lights go to the shared uniform buffers once; every program reads them from there
+        frameUniforms->update({ view, projection, cam.position });
+        {
+            LightUniforms lights{};
+            lights.setDirectional(directionalLight, enableDirectional);
+            lightUniforms->update(lights);
+        }
 
         // world transform
         glm::mat4 model = glm::mat4(1.0f);
-        shaderInstance.setMat4("model", model);
+
+        shaderInstance.use();
+        shaderInstance.setFloat(instanceUniforms.shininess, 32.0f);
+        shaderInstance.setMat4(instanceUniforms.draw.model, model);
 
         glBindVertexArray(0);
 
-        // Setting lit shader uniforms
         shaderLit.use();
-        {
-            shaderLit.setVec3("viewPos", cam.position);
-            shaderLit.setFloat("material.shininess", 32.0f);
-            
-            //Directional light
-            shaderLit.setBool("dirLight.enabled", enableDirectional);
-            shaderLit.setVec3("dirLight.direction", directionalLight.direction);
-            shaderLit.setVec3("dirLight.ambient", directionalLight.ambient);
-            shaderLit.setVec3("dirLight.diffuse", directionalLight.diffuse);
-            shaderLit.setVec3("dirLight.specular", directionalLight.specular);
-
-            shaderLit.setMat4("projection", projection);
-            shaderLit.setMat4("view", view);
-            shaderLit.setMat4("model", model);
-        }
+        shaderLit.setFloat(litUniforms.shininess, 32.0f);
+        shaderLit.setMat4(litUniforms.draw.model, model);
 
         // Model
         glm::mat4 newModelTransform = scale(newModelTransform, glm::vec3(0.5f));
@@ -342,18 +373,13 @@ int main(int, char**)
         mainModel.getNewWorld(model, true);
 
         glActiveTexture(GL_TEXTURE9);
-        shaderLit.setInt("skybox", 9);
+        shaderLit.setInt(litUniforms.skybox, 9);
         glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
 
-        mainModel.drawThis(glm::mat4(1.0f), shaderLit);
+        mainModel.drawThis(glm::mat4(1.0f), shaderLit, litUniforms.draw);
 
         shaderRefraction.use();
-        {
-            shaderRefraction.setVec3("cameraPos", cam.position);
-            shaderRefraction.setMat4("projection", projection);
-            shaderRefraction.setMat4("view", view);
-            shaderRefraction.setMat4("model", model);
-        }
+        shaderRefraction.setMat4(refractionUniforms.draw.model, model);
 
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
@@ -364,9 +390,6 @@ int main(int, char**)
         // Skybox
         glDepthFunc(GL_LEQUAL);
         shaderSkybox.use();
-        view = glm::mat4(glm::mat3(cam.getViewMatrix())); // remove translation part from view matrix
-        shaderSkybox.setMat4("view", view);
-        shaderSkybox.setMat4("projection", projection);
 
         glBindVertexArray(skyboxVAO);
         glActiveTexture(GL_TEXTURE0);
@@ -381,8 +404,18 @@ int main(int, char**)
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
         glfwMakeContextCurrent(window);
         glfwSwapBuffers(window);
+
+        // Evict what this frame did not draw, if the scene is over budget
+        ResidencyManager::instance().update();
     }
 
+    AssetWatcher::instance().stop();
+    loadedModel.reset();
+    shaderVariants.clear();
+    frameUniforms.reset();
+    lightUniforms.reset();
+    GeometryArena::releaseAll();
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -393,33 +426,104 @@ int main(int, char**)
     return 0;
 }
 
-GLuint loadCubemapTexture(std::vector<std::string> faces)
+// Faces are decoded concurrently and uploaded into immutable storage. Cooked faces bring their own
+// mip chain; decoded ones get a chain from glGenerateMipmap only when generateMipmaps is set.
+GLuint loadCubemapTexture(const std::vector<std::string>& faces, bool generateMipmaps)
 {
+    struct Face
+    {
+        CookedTexture cooked;
+        unsigned char* pixels = nullptr;
+        int width = 0, height = 0, channels = 0;
+    };
+    const auto start = std::chrono::steady_clock::now();
+
+    // Cooked faces come block compressed with their mip chain; all six must be cooked for that to be used
+    TextureLoader& loader = TextureLoader::instance();
+    loader.queryCompressionSupport();
+    std::vector<Face> decoded(faces.size());
+    bool allCooked = true;
+    for (size_t i = 0; i < faces.size(); i++)
+    {
+        allCooked = allCooked && decoded[i].cooked.open(faces[i]) && loader.supports(decoded[i].cooked.format()) &&
+            decoded[i].cooked.format() == decoded[0].cooked.format() && decoded[i].cooked.levelCount() == decoded[0].cooked.levelCount() &&
+            decoded[i].cooked.levelWidth(0) == decoded[0].cooked.levelWidth(0) && decoded[i].cooked.levelHeight(0) == decoded[0].cooked.levelHeight(0);
+    }
+    if (!allCooked)
+    {
+        ThreadPool::shared().parallelFor(faces.size(), [&](size_t i)
+        {
+            const FileData file = VirtualFileSystem::instance().open(faces[i]);
+            if (!file.isOpen()) return;
+            decoded[i].pixels = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &decoded[i].width, &decoded[i].height, &decoded[i].channels, 0);
+        });
+
+        // A complete cube map needs one size and format for every face
+        for (size_t i = 0; i < faces.size(); i++)
+        {
+            const Face& face = decoded[i];
+            if (face.pixels == nullptr || face.width != decoded[0].width || face.height != decoded[0].height || face.channels != decoded[0].channels)
+            {
+                std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
+                for (Face& other : decoded) stbi_image_free(other.pixels);
+                return 0;
+            }
+        }
+    }
+
+    const TextureFormat format = allCooked ? decoded[0].cooked.format() : BlockCompression::uncompressedFormat(decoded[0].channels);
+    const uint32_t width = allCooked ? decoded[0].cooked.levelWidth(0) : static_cast<uint32_t>(decoded[0].width);
+    const uint32_t height = allCooked ? decoded[0].cooked.levelHeight(0) : static_cast<uint32_t>(decoded[0].height);
+    uint32_t levelCount = allCooked ? decoded[0].cooked.levelCount() : 1;
+    if (!allCooked && generateMipmaps)
+    {
+        while ((std::max(width, height) >> levelCount) > 0) levelCount++;
+    }
+
     GLuint textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-    int width, height, channels;
+    // Immutable storage is GL 4.2; on the 4.1 context of macOS each level is specified the older way
+    const bool immutable = GLAD_GL_VERSION_4_2 != 0;
+    const auto uploadLevel = immutable ? TextureLoader::fillLevel : TextureLoader::specifyLevel;
+    if (immutable)
+    {
+        glTexStorage2D(GL_TEXTURE_CUBE_MAP, static_cast<GLsizei>(levelCount), textureFormatInfo(format).internalFormat, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+    }
+
+    GLint alignment;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     for (GLuint i = 0; i < faces.size(); i++)
     {
-	    if (unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &channels, 0))
+        const GLenum target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + i;
+        Face& face = decoded[i];
+        if (allCooked)
         {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
-            );
-            stbi_image_free(data);
+            for (uint32_t level = 0; level < levelCount; level++)
+            {
+                uploadLevel(target, static_cast<GLint>(level), format, face.cooked.levelWidth(level), face.cooked.levelHeight(level),
+                    face.cooked.faceSize(level), face.cooked.faceData(level), false);
+            }
         }
         else
         {
-            std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
+            uploadLevel(target, 0, format, width, height, static_cast<size_t>(width) * height * face.channels, face.pixels, false);
+            stbi_image_free(face.pixels);
         }
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    if (!allCooked && levelCount > 1) glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levelCount) - 1);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
+    spdlog::info("Skybox: {} faces {} in {:.1f} ms", faces.size(), allCooked ? "cooked" : "decoded",
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
     return textureID;
 }
@@ -0,0 +1,93 @@
+#include "ModelImporter.h"
+#include "TestCheck.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const std::string ROOT = "ModelImporterTest";
+
+    // Points and lines between the triangles of one object, and an object of lines only.
+    // Without normals, and 'p' and 'l' send it past ObjImporter to Assimp.
+    const char* MIXED_OBJ =
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 0 1 0\n"
+        "v 1 1 0\n"
+        "v 2 0 0\n"
+        "v 2 1 0\n"
+        "o mixed\n"
+        "p 1\n"
+        "f 1 2 3\n"
+        "l 1 2 3\n"
+        "f 2 4 3\n"
+        "p 5\n"
+        "f 2 5 4\n"
+        "o wire\n"
+        "l 4 5 6\n"
+        "o quad\n"
+        "f 4 5 6\n";
+
+    bool validTriangles(const MeshData& mesh)
+    {
+        if (mesh.indices.size() % 3 != 0) return false;
+        for (unsigned int index : mesh.indices)
+        {
+            if (index >= mesh.vertices.size()) return false;
+        }
+        for (size_t i = 0; i < mesh.indices.size(); i += 3)
+        {
+            const unsigned int a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+            if (a == b || b == c || a == c) return false;
+        }
+        return true;
+    }
+
+    void testPointsAndLinesAreDropped()
+    {
+        const std::string path = ROOT + "/mixed.obj";
+        std::filesystem::create_directories(ROOT);
+        std::ofstream(path, std::ios::binary) << MIXED_OBJ;
+
+        for (ModelImporter::Parser parser : { ModelImporter::Parser::Auto, ModelImporter::Parser::Assimp })
+        {
+            std::vector<MeshData> meshes;
+            CHECK(ModelImporter::load(path, meshes, nullptr, parser));
+
+            // The wire object has no triangles and no mesh
+            CHECK(meshes.size() == 2);
+            size_t indexCount = 0;
+            for (const MeshData& mesh : meshes)
+            {
+                CHECK(validTriangles(mesh));
+                indexCount += mesh.indices.size();
+            }
+            CHECK(indexCount == 4 * 3);
+        }
+
+        // Merged by material, every triangle keeps its own corners and every level of detail its own range
+        std::vector<MeshData> meshes;
+        CHECK(ModelImporter::import(path, ImportSettings(), meshes));
+        CHECK(meshes.size() == 1);
+        if (meshes.size() != 1) return;
+        const MeshData& merged = meshes[0];
+        CHECK(merged.indices.size() == 4 * 3);
+        CHECK(validTriangles(merged));
+        CHECK(!merged.lods.empty() && merged.lods[0].indexCount == merged.indices.size());
+        for (const MeshLod& lod : merged.lods)
+        {
+            CHECK(lod.indexCount % 3 == 0 && lod.firstIndex + lod.indexCount <= merged.indices.size());
+        }
+    }
+}
+
+int main()
+{
+    std::filesystem::remove_all(ROOT);
+    testPointsAndLinesAreDropped();
+    std::filesystem::remove_all(ROOT);
+    return testResult();
+}
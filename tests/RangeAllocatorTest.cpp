@@ -0,0 +1,130 @@
+#include "GeometryArena.h"
+#include "TestCheck.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace
+{
+    struct Allocation
+    {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    void testAllocateAndFree()
+    {
+        RangeAllocator allocator;
+        CHECK(allocator.allocate(1) == RangeAllocator::INVALID);
+        allocator.grow(100);
+        CHECK(allocator.capacity() == 100 && allocator.used() == 0 && allocator.largestFree() == 100);
+
+        const uint32_t a = allocator.allocate(30), b = allocator.allocate(30), c = allocator.allocate(40);
+        CHECK(a == 0 && b == 30 && c == 60);
+        CHECK(allocator.used() == 100 && allocator.largestFree() == 0);
+        CHECK(allocator.allocate(1) == RangeAllocator::INVALID);
+        CHECK(allocator.allocate(0) == 0);
+
+        // Freed neighbours merge back into one block, whichever side is released first
+        allocator.free(a, 30);
+        allocator.free(c, 40);
+        CHECK(allocator.fragments() == 2);
+        allocator.free(b, 30);
+        CHECK(allocator.fragments() == 1 && allocator.used() == 0 && allocator.largestFree() == 100);
+    }
+
+    void testBestFit()
+    {
+        RangeAllocator allocator;
+        allocator.grow(100);
+        const uint32_t a = allocator.allocate(10), b = allocator.allocate(20), c = allocator.allocate(5), d = allocator.allocate(30);
+        allocator.allocate(35);
+        allocator.free(a, 10);
+        allocator.free(c, 5);
+        CHECK(allocator.allocate(5) == c);
+        CHECK(allocator.allocate(8) == a);
+
+        // b merges with the 2 units left after a; d stays apart, since c is taken again
+        allocator.free(b, 20);
+        allocator.free(d, 30);
+        CHECK(allocator.allocate(25) == d);
+        CHECK(allocator.allocate(22) == a + 8);
+    }
+
+    void testGrowAndCompact()
+    {
+        RangeAllocator allocator;
+        allocator.grow(64);
+        const uint32_t a = allocator.allocate(16);
+        allocator.allocate(40);
+        allocator.free(a, 16);
+
+        // New units merge with a free block ending at the old capacity
+        allocator.grow(128);
+        CHECK(allocator.capacity() == 128 && allocator.used() == 40 && allocator.largestFree() == 72);
+        CHECK(allocator.allocate(72) == 56);
+        allocator.grow(100); // shrinking is ignored
+        CHECK(allocator.capacity() == 128);
+
+        // After the owner packs its ranges to the front, the free list is one block at the end
+        allocator.free(56, 72);
+        allocator.compact();
+        CHECK(allocator.fragments() == 1 && allocator.largestFree() == 88);
+        CHECK(allocator.allocate(88) == 40);
+    }
+
+    void testRandomAgainstShadow()
+    {
+        std::mt19937 rng(7);
+        RangeAllocator allocator;
+        allocator.grow(4096);
+        std::vector<uint8_t> owner(allocator.capacity(), 0);
+        std::vector<Allocation> live;
+        uint32_t used = 0;
+        for (int step = 0; step < 20000; step++)
+        {
+            if (live.empty() || rng() % 3 != 0)
+            {
+                const uint32_t size = 1 + rng() % 64;
+                const uint32_t offset = allocator.allocate(size);
+                if (offset == RangeAllocator::INVALID)
+                {
+                    CHECK(allocator.largestFree() < size);
+                    allocator.grow(allocator.capacity() * 2);
+                    owner.resize(allocator.capacity(), 0);
+                    continue;
+                }
+                bool overlaps = offset + size > allocator.capacity();
+                for (uint32_t i = offset; i < offset + size && !overlaps; i++) overlaps = owner[i] != 0;
+                CHECK(!overlaps);
+                for (uint32_t i = offset; i < offset + size && i < owner.size(); i++) owner[i] = 1;
+                live.push_back({ offset, size });
+                used += size;
+            }
+            else
+            {
+                const size_t pick = rng() % live.size();
+                const Allocation freed = live[pick];
+                live[pick] = live.back();
+                live.pop_back();
+                allocator.free(freed.offset, freed.size);
+                for (uint32_t i = freed.offset; i < freed.offset + freed.size; i++) owner[i] = 0;
+                used -= freed.size;
+            }
+            CHECK(allocator.used() == used);
+        }
+
+        for (const Allocation& allocation : live) allocator.free(allocation.offset, allocation.size);
+        CHECK(allocator.used() == 0 && allocator.fragments() == 1 && allocator.largestFree() == allocator.capacity());
+    }
+}
+
+int main()
+{
+    testAllocateAndFree();
+    testBestFit();
+    testGrowAndCompact();
+    testRandomAgainstShadow();
+    return testResult();
+}
@@ -0,0 +1,114 @@
+#include "ShaderPreprocessor.h"
+#include "TestCheck.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Scratch shaders live under the working directory, which ctest sets to the build folder
+    const std::string ROOT = "ShaderPreprocessorTest";
+
+    void writeFile(const std::string& path, const std::string& text)
+    {
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+        std::ofstream(path, std::ios::binary) << text;
+    }
+
+    bool contains(const std::string& text, const std::string& part)
+    {
+        return text.find(part) != std::string::npos;
+    }
+
+    size_t count(const std::string& text, const std::string& part)
+    {
+        size_t found = 0;
+        for (size_t at = text.find(part); at != std::string::npos; at = text.find(part, at + part.size())) found++;
+        return found;
+    }
+
+    void testDefines()
+    {
+        const ShaderDefines a = ShaderDefines().set("B", 2).set("A");
+        const ShaderDefines b{ { "A", "1" }, { "B", "2" } };
+        CHECK(a.text() == "#define A 1\n#define B 2\n");
+        CHECK(a.hash() == b.hash());
+        CHECK(ShaderDefines(a).set("B", 3).hash() != a.hash());
+        CHECK(ShaderDefines().empty() && !a.empty());
+    }
+
+    void testIncludes()
+    {
+        writeFile(ROOT + "/main.frag",
+            "#version 330 core\n"
+            "#include \"include/common.glsl\"\n"
+            "#include \"include/common.glsl\"\n"
+            "void main() {}\n");
+        writeFile(ROOT + "/include/common.glsl",
+            "#pragma once\n"
+            "#include \"../main.frag\"\n"
+            "#include \"more.glsl\"\n"
+            "float common() { return 1.0; }\n");
+        writeFile(ROOT + "/include/more.glsl", "  #include \"common.glsl\"  \r\nfloat more() { return 2.0; }\n");
+
+        std::string out;
+        std::vector<std::string> files;
+        CHECK(ShaderPreprocessor::process(ROOT + "/./main.frag", ShaderDefines().set("LIGHTS", 4), out, files));
+
+        // Relative to the including file, normalized, each pulled in once and numbered in order
+        CHECK((files == std::vector<std::string>{ ROOT + "/main.frag", ROOT + "/include/common.glsl", ROOT + "/include/more.glsl" }));
+        CHECK(out.starts_with("#version 330 core\n#define LIGHTS 4\n#line 2 0\n"));
+        CHECK(count(out, "float common()") == 1 && count(out, "float more()") == 1 && count(out, "void main()") == 1);
+        CHECK(!contains(out, "#pragma once") && !contains(out, "#include"));
+
+        // #line brackets every include: into the file at line 1, back out at the next line
+        CHECK(contains(out, "#line 1 1\n"));
+        CHECK(contains(out, "#line 1 2\n"));
+        CHECK(contains(out, "#line 4 1\nfloat common()"));
+        CHECK(contains(out, "#line 3 0\n"));
+    }
+
+    void testWithoutVersion()
+    {
+        writeFile(ROOT + "/noversion.glsl", "float x;\n");
+        std::string out;
+        std::vector<std::string> files;
+        CHECK(ShaderPreprocessor::process(ROOT + "/noversion.glsl", ShaderDefines().set("X"), out, files));
+        CHECK(out == "#define X 1\n#line 1 0\nfloat x;\n");
+    }
+
+    void testErrors()
+    {
+        std::string out;
+        std::vector<std::string> files;
+        CHECK(!ShaderPreprocessor::process(ROOT + "/missing.frag", {}, out, files));
+
+        writeFile(ROOT + "/broken.frag", "#version 330 core\n#include \"missing.glsl\"\n");
+        CHECK(!ShaderPreprocessor::process(ROOT + "/broken.frag", {}, out, files));
+
+        writeFile(ROOT + "/malformed.frag", "#version 330 core\n#include \"unterminated.glsl\n");
+        CHECK(!ShaderPreprocessor::process(ROOT + "/malformed.frag", {}, out, files));
+
+        // A chain of distinct files deeper than the limit
+        for (int i = 0; i <= ShaderPreprocessor::MAX_INCLUDE_DEPTH + 1; i++)
+        {
+            writeFile(ROOT + "/deep/" + std::to_string(i) + ".glsl", "#include \"" + std::to_string(i + 1) + ".glsl\"\n");
+        }
+        writeFile(ROOT + "/deep/" + std::to_string(ShaderPreprocessor::MAX_INCLUDE_DEPTH + 2) + ".glsl", "float end;\n");
+        CHECK(!ShaderPreprocessor::process(ROOT + "/deep/0.glsl", {}, out, files));
+        CHECK(ShaderPreprocessor::process(ROOT + "/deep/2.glsl", {}, out, files));
+    }
+}
+
+int main()
+{
+    std::filesystem::remove_all(ROOT);
+    testDefines();
+    testIncludes();
+    testWithoutVersion();
+    testErrors();
+    std::filesystem::remove_all(ROOT);
+    return testResult();
+}
@@ -0,0 +1,141 @@
+#include "LzCodec.h"
+#include "StreamCodec.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    std::mt19937 rng(12345);
+
+    std::vector<uint8_t> randomBytes(size_t size)
+    {
+        std::vector<uint8_t> bytes(size);
+        for (uint8_t& byte : bytes) byte = static_cast<uint8_t>(rng());
+        return bytes;
+    }
+
+    // Words that drift slowly per element, like positions and optimized index lists
+    std::vector<uint8_t> smoothStream(size_t count, size_t stride)
+    {
+        std::vector<uint8_t> bytes(count * stride);
+        const size_t period = stride / 4;
+        for (size_t i = 0; i < count * period; i++)
+        {
+            const uint32_t word = static_cast<uint32_t>((i / period) * (i % period + 1) + rng() % 5) - 2u;
+            std::memcpy(bytes.data() + i * 4, &word, 4);
+        }
+        return bytes;
+    }
+
+    bool lzRoundTrip(const std::vector<uint8_t>& source)
+    {
+        const std::vector<uint8_t> compressed = LzCodec::compress(source.data(), source.size());
+        std::vector<uint8_t> decompressed(source.size() + 1, 0xCD);
+        if (!LzCodec::decompress(compressed.data(), compressed.size(), decompressed.data(), source.size())) return false;
+        return std::equal(source.begin(), source.end(), decompressed.begin()) && decompressed.back() == 0xCD;
+    }
+
+    bool streamRoundTrip(const std::vector<uint8_t>& source, size_t count, size_t stride)
+    {
+        const std::vector<uint8_t> encoded = StreamCodec::encode(source.data(), count, stride);
+        std::vector<uint8_t> decoded(count * stride + 1, 0xCD);
+        if (!StreamCodec::decode(encoded.data(), encoded.size(), decoded.data(), count, stride)) return false;
+        return std::equal(source.begin(), source.end(), decoded.begin()) && decoded.back() == 0xCD;
+    }
+
+    void testLzEdgeCases()
+    {
+        CHECK(lzRoundTrip({}));
+        CHECK(lzRoundTrip({ 7 }));
+        CHECK(lzRoundTrip({ 1, 2, 3, 4, 1, 2, 3, 4 }));
+
+        // Overlapping matches: a short period repeated far past its own length
+        for (size_t period = 1; period < 16; period++)
+        {
+            std::vector<uint8_t> source = randomBytes(period);
+            while (source.size() < 300) source.push_back(source[source.size() - period]);
+            CHECK(lzRoundTrip(source));
+        }
+
+        // Literal and match lengths that need extra length bytes
+        std::vector<uint8_t> longRuns = randomBytes(1000);
+        longRuns.insert(longRuns.end(), 5000, 0x42);
+        const std::vector<uint8_t> tail = randomBytes(17);
+        longRuns.insert(longRuns.end(), tail.begin(), tail.end());
+        CHECK(lzRoundTrip(longRuns));
+
+        // Incompressible input grows by no more than the reserved worst case
+        const std::vector<uint8_t> noise = randomBytes(100000);
+        const std::vector<uint8_t> compressed = LzCodec::compress(noise.data(), noise.size());
+        CHECK(compressed.size() <= noise.size() + noise.size() / 255 + 16);
+        CHECK(lzRoundTrip(noise));
+    }
+
+    void testLzRejectsMalformedInput()
+    {
+        const std::vector<uint8_t> source = { 1, 2, 3, 4, 1, 2, 3, 4, 1, 2, 3, 4, 9 };
+        const std::vector<uint8_t> compressed = LzCodec::compress(source.data(), source.size());
+        std::vector<uint8_t> out(source.size() + 64);
+
+        CHECK(!LzCodec::decompress(compressed.data(), compressed.size(), out.data(), source.size() - 1));
+        CHECK(!LzCodec::decompress(compressed.data(), compressed.size(), out.data(), source.size() + 1));
+        CHECK(!LzCodec::decompress(compressed.data(), compressed.size() - 2, out.data(), source.size()));
+
+        // A match before the start of the output, and one with offset 0
+        const uint8_t beforeStart[] = { 0x10, 'a', 0x02, 0x00 };
+        CHECK(!LzCodec::decompress(beforeStart, sizeof(beforeStart), out.data(), 5));
+        const uint8_t zeroOffset[] = { 0x10, 'a', 0x00, 0x00 };
+        CHECK(!LzCodec::decompress(zeroOffset, sizeof(zeroOffset), out.data(), 5));
+    }
+
+    void testStreamStrides()
+    {
+        // Strides below, at and above 16 bytes, multiples of 16 or not, up to the 64-word maximum;
+        // counts leave the decoder with no SSE2 block, a partial one, or whole blocks and a tail
+        for (size_t stride : { 4, 8, 12, 16, 20, 24, 32, 36, 48, 64, 256 })
+        {
+            for (size_t count : { 0, 1, 3, 5, 15, 16, 17, 33, 1000 })
+            {
+                CHECK(streamRoundTrip(smoothStream(count, stride), count, stride));
+                CHECK(streamRoundTrip(randomBytes(count * stride), count, stride));
+            }
+        }
+
+        // Deltas at the extremes of the zig-zag fold
+        const uint32_t extremes[] = { 0, 0xFFFFFFFFu, 0x80000000u, 0x7FFFFFFFu, 1, 0x80000001u, 0, 0x7FFFFFFFu };
+        std::vector<uint8_t> bytes(sizeof(extremes) * 8);
+        for (size_t i = 0; i < 8; i++) std::memcpy(bytes.data() + i * sizeof(extremes), extremes, sizeof(extremes));
+        CHECK(streamRoundTrip(bytes, bytes.size() / 4, 4));
+        CHECK(streamRoundTrip(bytes, bytes.size() / 16, 16));
+    }
+
+    void testStreamRejectsBadInput()
+    {
+        const std::vector<uint8_t> source = smoothStream(100, 32);
+        const std::vector<uint8_t> encoded = StreamCodec::encode(source.data(), 100, 32);
+        std::vector<uint8_t> out(source.size());
+
+        CHECK(!StreamCodec::decode(encoded.data(), encoded.size() / 2, out.data(), 100, 32));
+        CHECK(!StreamCodec::decode(encoded.data(), encoded.size(), out.data(), 99, 32));
+
+        // More words per element than the decoder carries
+        const std::vector<uint8_t> wide = smoothStream(4, 260);
+        const std::vector<uint8_t> wideEncoded = StreamCodec::encode(wide.data(), 4, 260);
+        std::vector<uint8_t> wideOut(wide.size());
+        CHECK(!StreamCodec::decode(wideEncoded.data(), wideEncoded.size(), wideOut.data(), 4, 260));
+    }
+}
+
+int main()
+{
+    testLzEdgeCases();
+    testLzRejectsMalformedInput();
+    testStreamStrides();
+    testStreamRejectsBadInput();
+    return testResult();
+}
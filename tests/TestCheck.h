@@ -0,0 +1,27 @@
+#pragma once
+
+#include <iostream>
+
+// Minimal checks for the unit tests: a failed CHECK prints its location and is counted, the test
+// keeps going, and main returns testResult() so ctest sees any failure.
+inline int& testFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+inline int testResult()
+{
+    if (testFailures() > 0) std::cout << testFailures() << " check(s) failed" << std::endl;
+    return testFailures() > 0 ? 1 : 0;
+}
+
+#define CHECK(condition)                                                                            \
+    do                                                                                              \
+    {                                                                                               \
+        if (!(condition))                                                                           \
+        {                                                                                           \
+            std::cout << __FILE__ << '(' << __LINE__ << "): CHECK(" #condition ") failed" << std::endl; \
+            testFailures()++;                                                                       \
+        }                                                                                           \
+    } while (false)
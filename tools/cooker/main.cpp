@@ -0,0 +1,462 @@
+// Offline asset cooker: walks an asset directory and turns every model and texture into the
+// runtime-ready files OpenGLGP maps at load time (cache/meshes, cache/textures).
+// Run it from the directory the application runs in, so the cache paths line up.
+//
+// Usage: AssetCooker [--force] [--uncompressed] [--stdio] [asset root, default "res"]
+//        AssetCooker --benchmark-obj [asset root]   compares ObjImporter with Assimp, writes nothing
+//        AssetCooker --benchmark-io [asset root]    compares mapped and stdio file access in Assimp, writes nothing
+//        AssetCooker --benchmark-codec [asset root] measures the mesh stream codec on the imported models, writes nothing
+//        AssetCooker --pak res.pak [asset root]     cooks, then packs the asset root and its cooked files into one package
+
+#include <spdlog/spdlog.h>
+
+#include "AssetHash.h"
+#include "CookedTexture.h"
+#include "ImportSettings.h"
+#include "MeshCache.h"
+#include "ModelImporter.h"
+#include "ObjImporter.h"
+#include "Pak.h"
+#include "StreamCodec.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+// Every file that went into one cooked output, as it was when the output was written
+struct ManifestEntry
+{
+    std::string kind;
+    uint64_t cookKey = 0;
+    std::vector<std::pair<std::string, SourceStamp>> inputs;
+};
+
+// cache/manifest.txt, one tab separated record per line:
+//   asset <kind> <cook key> <source path>
+//   input <size> <mtime> <content hash> <path>   (one per input, following their asset)
+class Manifest
+{
+public:
+    static constexpr const char* PATH = "cache/manifest.txt";
+
+    std::unordered_map<std::string, ManifestEntry> entries;
+
+    void load()
+    {
+        std::ifstream in(PATH);
+        std::string line;
+        ManifestEntry* current = nullptr;
+        while (std::getline(in, line))
+        {
+            const std::vector<std::string> fields = split(line);
+            if (fields.size() == 4 && fields[0] == "asset")
+            {
+                current = &entries[fields[3]];
+                current->kind = fields[1];
+                current->cookKey = std::stoull(fields[2], nullptr, 16);
+                current->inputs.clear();
+            }
+            else if (fields.size() == 5 && fields[0] == "input" && current)
+            {
+                SourceStamp stamp;
+                stamp.size = std::stoull(fields[1]);
+                stamp.mtime = std::stoll(fields[2]);
+                stamp.hash = std::stoull(fields[3], nullptr, 16);
+                current->inputs.emplace_back(fields[4], stamp);
+            }
+        }
+    }
+
+    bool save() const
+    {
+        std::vector<const std::pair<const std::string, ManifestEntry>*> sorted;
+        for (const auto& entry : entries) sorted.push_back(&entry);
+        std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+        const std::string tempPath = std::string(PATH) + ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::trunc);
+            if (!out) return false;
+            char key[32];
+            for (const auto* entry : sorted)
+            {
+                std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(entry->second.cookKey));
+                out << "asset\t" << entry->second.kind << '\t' << key << '\t' << entry->first << '\n';
+                for (const auto& [path, stamp] : entry->second.inputs)
+                {
+                    std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(stamp.hash));
+                    out << "input\t" << stamp.size << '\t' << stamp.mtime << '\t' << key << '\t' << path << '\n';
+                }
+            }
+            if (!out) return false;
+        }
+        std::error_code ec;
+        std::filesystem::rename(tempPath, PATH, ec);
+        return !ec;
+    }
+
+private:
+    static std::vector<std::string> split(const std::string& line)
+    {
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, '\t')) fields.push_back(field);
+        return fields;
+    }
+};
+
+struct CookJob
+{
+    std::string kind;
+    std::string path;
+    uint64_t cookKey = 0;
+    bool upToDate = false;
+    bool succeeded = false;
+    ManifestEntry result;
+};
+
+static bool isTextureFile(const std::filesystem::path& path)
+{
+    static const std::vector<std::string> extensions = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".psd", ".gif", ".hdr", ".pic", ".pnm" };
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return std::find(extensions.begin(), extensions.end(), extension) != extensions.end();
+}
+
+static bool isUpToDate(const CookJob& job, const Manifest& manifest, const std::string& outputPath)
+{
+    const auto entry = manifest.entries.find(job.path);
+    if (entry == manifest.entries.end() || entry->second.kind != job.kind || entry->second.cookKey != job.cookKey) return false;
+    if (entry->second.inputs.empty() || !std::filesystem::exists(outputPath)) return false;
+    for (const auto& [path, stamp] : entry->second.inputs)
+    {
+        bool touched = false;
+        if (!stamp.matches(path, touched)) return false;
+    }
+    return true;
+}
+
+static void cook(CookJob& job, const ImportSettings& settings, bool compressTextures)
+{
+    std::vector<std::string> inputs;
+    if (job.kind == "model")
+    {
+        std::vector<MeshData> meshes;
+        job.succeeded = ModelImporter::import(job.path, settings, meshes, &inputs) &&
+            MeshCache::write(job.path, settings.key(ModelImporter::IMPORT_FLAGS), meshes, inputs);
+    }
+    else
+    {
+        job.succeeded = CookedTexture::cook(job.path, compressTextures);
+    }
+    if (!job.succeeded) return;
+
+    // Assimp may open the same file more than once; the source itself always comes first
+    inputs.insert(inputs.begin(), job.path);
+    job.result.kind = job.kind;
+    job.result.cookKey = job.cookKey;
+    for (const std::string& input : inputs)
+    {
+        const std::string normalized = MeshCache::normalizePath(input);
+        const bool seen = std::any_of(job.result.inputs.begin(), job.result.inputs.end(), [&](const auto& known) { return known.first == normalized; });
+        SourceStamp stamp;
+        if (!seen && SourceStamp::capture(normalized, stamp)) job.result.inputs.emplace_back(normalized, stamp);
+    }
+}
+
+// Best of a few runs of the parse step alone; optimization and LOD work is the same for both parsers
+static double timeLoad(const std::string& path, ModelImporter::Parser parser, size_t& vertexCount, size_t& triangleCount)
+{
+    constexpr int RUNS = 5;
+    double best = 0.0;
+    for (int run = 0; run < RUNS; run++)
+    {
+        std::vector<MeshData> meshes;
+        const auto start = std::chrono::steady_clock::now();
+        if (!ModelImporter::load(path, meshes, nullptr, parser)) return -1.0;
+        const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = run == 0 ? elapsed : std::min(best, elapsed);
+
+        vertexCount = triangleCount = 0;
+        for (const MeshData& mesh : meshes)
+        {
+            vertexCount += mesh.vertices.size();
+            triangleCount += mesh.indices.size() / 3;
+        }
+    }
+    return best;
+}
+
+static int benchmarkObj(const std::string& root)
+{
+    std::error_code ec;
+    double totalFast = 0.0, totalAssimp = 0.0;
+    for (const auto& item : std::filesystem::recursive_directory_iterator(root, std::filesystem::directory_options::follow_directory_symlink, ec))
+    {
+        const std::string path = MeshCache::normalizePath(item.path().generic_string());
+        if (!item.is_regular_file() || !ObjImporter::isObjFile(path)) continue;
+
+        size_t fastVertices = 0, fastTriangles = 0, assimpVertices = 0, assimpTriangles = 0;
+        const double fast = timeLoad(path, ModelImporter::Parser::Auto, fastVertices, fastTriangles);
+        const double assimp = timeLoad(path, ModelImporter::Parser::Assimp, assimpVertices, assimpTriangles);
+        if (fast < 0.0 || assimp < 0.0) continue;
+
+        spdlog::info("{}: ObjImporter {:.2f} ms ({} vertices), Assimp {:.2f} ms ({} vertices), {} triangles, {:.1f}x", path,
+            fast, fastVertices, assimp, assimpVertices, assimpTriangles, fast > 0.0 ? assimp / fast : 0.0);
+        if (fastTriangles != assimpTriangles)
+        {
+            spdlog::warn("{}: triangle count differs, ObjImporter produced {}", path, fastTriangles);
+        }
+        totalFast += fast;
+        totalAssimp += assimp;
+    }
+    spdlog::info("Total: ObjImporter {:.2f} ms, Assimp {:.2f} ms", totalFast, totalAssimp);
+    return 0;
+}
+
+// Alternates the two modes run by run, so both see the same page cache state
+static int benchmarkIo(const std::string& root)
+{
+    constexpr int RUNS = 5;
+    std::error_code ec;
+    double totalMapped = 0.0, totalStdio = 0.0;
+    for (const auto& item : std::filesystem::recursive_directory_iterator(root, std::filesystem::directory_options::follow_directory_symlink, ec))
+    {
+        const std::string path = MeshCache::normalizePath(item.path().generic_string());
+        if (!item.is_regular_file() || !ModelImporter::isModelFile(path)) continue;
+
+        double best[2] = { 0.0, 0.0 };
+        bool failed = false;
+        for (int run = 0; run < RUNS && !failed; run++)
+        {
+            for (int mode = 0; mode < 2; mode++)
+            {
+                ModelImporter::setMappedIO(mode == 0);
+                std::vector<MeshData> meshes;
+                const auto start = std::chrono::steady_clock::now();
+                failed = !ModelImporter::load(path, meshes, nullptr, ModelImporter::Parser::Assimp);
+                const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                best[mode] = run == 0 ? elapsed : std::min(best[mode], elapsed);
+            }
+        }
+        ModelImporter::setMappedIO(true);
+        if (failed) continue;
+
+        spdlog::info("{}: mapped {:.2f} ms, stdio {:.2f} ms, {:.2f}x", path, best[0], best[1], best[0] > 0.0 ? best[1] / best[0] : 0.0);
+        totalMapped += best[0];
+        totalStdio += best[1];
+    }
+    spdlog::info("Total: mapped {:.2f} ms, stdio {:.2f} ms", totalMapped, totalStdio);
+    return 0;
+}
+
+// Compression ratio of the mesh cache streams against raw and plain LZ storage, and the decode
+// throughput into ordinary memory, best of a few runs
+static int benchmarkCodec(const std::string& root)
+{
+    constexpr int RUNS = 10;
+    const ImportSettings settings;
+    std::error_code ec;
+    uint64_t totalRaw = 0, totalLz = 0, totalEncoded = 0;
+    double totalDecode = 0.0;
+    for (const auto& item : std::filesystem::recursive_directory_iterator(root, std::filesystem::directory_options::follow_directory_symlink, ec))
+    {
+        const std::string path = MeshCache::normalizePath(item.path().generic_string());
+        if (!item.is_regular_file() || !ModelImporter::isModelFile(path)) continue;
+
+        std::vector<MeshData> meshes;
+        if (!ModelImporter::import(path, settings, meshes)) continue;
+
+        struct Stream
+        {
+            const void* data;
+            size_t count, stride;
+            std::vector<uint8_t> encoded;
+        };
+        std::vector<Stream> streams;
+        uint64_t raw = 0, lz = 0, encoded = 0;
+        for (const MeshData& mesh : meshes)
+        {
+            streams.push_back({ mesh.vertices.data(), mesh.vertices.size(), sizeof(Vertex), {} });
+            streams.push_back({ mesh.indices.data(), mesh.indices.size(), sizeof(GLuint), {} });
+        }
+        for (Stream& stream : streams)
+        {
+            stream.encoded = StreamCodec::encode(stream.data, stream.count, stream.stride);
+            raw += stream.count * stream.stride;
+            lz += LzCodec::compress(static_cast<const uint8_t*>(stream.data), stream.count * stream.stride).size();
+            encoded += stream.encoded.size();
+        }
+
+        std::vector<uint8_t> output;
+        for (const Stream& stream : streams)
+        {
+            output.resize(stream.count * stream.stride);
+            if (!StreamCodec::decode(stream.encoded.data(), stream.encoded.size(), output.data(), stream.count, stream.stride) ||
+                std::memcmp(output.data(), stream.data, output.size()) != 0)
+            {
+                spdlog::error("{}: stream does not round-trip", path);
+                return 1;
+            }
+        }
+
+        double best = 0.0;
+        for (int run = 0; run < RUNS; run++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (const Stream& stream : streams)
+            {
+                output.resize(stream.count * stream.stride);
+                StreamCodec::decode(stream.encoded.data(), stream.encoded.size(), output.data(), stream.count, stream.stride);
+            }
+            const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = run == 0 ? elapsed : std::min(best, elapsed);
+        }
+
+        spdlog::info("{}: {:.2f} MB raw, LZ {:.1f}%, codec {:.1f}%, decode {:.2f} GB/s", path, raw / (1024.0 * 1024.0),
+            100.0 * lz / std::max<uint64_t>(raw, 1), 100.0 * encoded / std::max<uint64_t>(raw, 1), best > 0.0 ? raw / best / 1e9 : 0.0);
+        totalRaw += raw;
+        totalLz += lz;
+        totalEncoded += encoded;
+        totalDecode += best;
+    }
+    spdlog::info("Total: {:.2f} MB raw, LZ {:.1f}%, codec {:.1f}%, decode {:.2f} GB/s", totalRaw / (1024.0 * 1024.0),
+        100.0 * totalLz / std::max<uint64_t>(totalRaw, 1), 100.0 * totalEncoded / std::max<uint64_t>(totalRaw, 1), totalDecode > 0.0 ? totalRaw / totalDecode / 1e9 : 0.0);
+    return 0;
+}
+
+// Packs every file under root plus the cooked files of the jobs, under the paths the runtime asks for
+static bool writePackage(const std::string& pakPath, const std::string& root, const std::vector<CookJob>& jobs)
+{
+    std::vector<std::string> paths;
+    std::error_code ec;
+    for (const auto& item : std::filesystem::recursive_directory_iterator(root, std::filesystem::directory_options::follow_directory_symlink, ec))
+    {
+        const std::string path = MeshCache::normalizePath(item.path().generic_string());
+        if (item.is_regular_file() && path != MeshCache::normalizePath(pakPath)) paths.push_back(path);
+    }
+    for (const CookJob& job : jobs)
+    {
+        const std::string output = job.kind == "model" ? MeshCache::cachePathFor(job.path) : CookedTexture::cachePathFor(job.path);
+        if (std::filesystem::exists(output, ec)) paths.push_back(output);
+    }
+
+    PakWriter writer;
+    for (const std::string& path : paths)
+    {
+        const MappedFile file(path);
+        std::vector<uint8_t> bytes;
+        if (file.isOpen()) bytes.assign(file.data(), file.data() + file.size());
+        writer.add(path, std::move(bytes));
+    }
+
+    PakWriter::Stats stats;
+    const auto start = std::chrono::steady_clock::now();
+    if (!writer.write(pakPath, true, &stats)) return false;
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    spdlog::info("Packed {} files into {} in {:.2f}s: {:.1f} MB -> {:.1f} MB, {} entries compressed", stats.entries, pakPath, elapsed,
+        stats.inputBytes / (1024.0 * 1024.0), stats.storedBytes / (1024.0 * 1024.0), stats.compressed);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    bool force = false, benchmark = false, benchmarkIO = false, benchmarkStreams = false, compressTextures = true;
+    std::string root = "res", pakPath;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--force") force = true;
+        else if (argument == "--pak" && i + 1 < argc) pakPath = argv[++i];
+        else if (argument == "--benchmark-obj") benchmark = true;
+        else if (argument == "--benchmark-io") benchmarkIO = true;
+        else if (argument == "--benchmark-codec") benchmarkStreams = true;
+        else if (argument == "--stdio") ModelImporter::setMappedIO(false);
+        else if (argument == "--uncompressed") compressTextures = false;
+        else root = argument;
+    }
+
+    std::error_code ec;
+    if (!std::filesystem::is_directory(root, ec))
+    {
+        spdlog::error("Asset root {} is not a directory", root);
+        return 1;
+    }
+    if (benchmark) return benchmarkObj(root);
+    if (benchmarkIO) return benchmarkIo(root);
+    if (benchmarkStreams) return benchmarkCodec(root);
+    std::filesystem::create_directories("cache", ec);
+
+    // Runtime defaults, so Model finds the meshes under the same import key
+    const ImportSettings settings;
+    const uint64_t modelKey = hashBytes(&MESH_CACHE_VERSION, sizeof(MESH_CACHE_VERSION), settings.key(ModelImporter::IMPORT_FLAGS));
+    const uint64_t textureKey = hashBytes(&compressTextures, sizeof(compressTextures), hashBytes(&COOKED_TEXTURE_VERSION, sizeof(COOKED_TEXTURE_VERSION)));
+
+    std::vector<CookJob> jobs;
+    for (const auto& item : std::filesystem::recursive_directory_iterator(root, std::filesystem::directory_options::follow_directory_symlink, ec))
+    {
+        if (!item.is_regular_file()) continue;
+        const std::string path = MeshCache::normalizePath(item.path().generic_string());
+        if (isTextureFile(item.path())) jobs.push_back({ "texture", path, textureKey });
+        else if (ModelImporter::isModelFile(path)) jobs.push_back({ "model", path, modelKey });
+    }
+
+    Manifest manifest;
+    if (!force) manifest.load();
+
+    const auto start = std::chrono::steady_clock::now();
+    std::atomic<size_t> cooked = 0, failed = 0;
+    ThreadPool::shared().parallelFor(jobs.size(), [&](size_t i)
+    {
+        CookJob& job = jobs[i];
+        const std::string output = job.kind == "model" ? MeshCache::cachePathFor(job.path) : CookedTexture::cachePathFor(job.path);
+        job.upToDate = !force && isUpToDate(job, manifest, output);
+        if (job.upToDate) return;
+
+        cook(job, settings, compressTextures);
+        if (job.succeeded)
+        {
+            cooked++;
+            spdlog::info("Cooked {} {}", job.kind, job.path);
+        }
+        else
+        {
+            failed++;
+            spdlog::error("Failed to cook {} {}", job.kind, job.path);
+        }
+    });
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Entries of deleted sources drop out; failed jobs keep no entry, so they are retried next run
+    Manifest updated;
+    for (CookJob& job : jobs)
+    {
+        if (job.upToDate) updated.entries[job.path] = manifest.entries[job.path];
+        else if (job.succeeded) updated.entries[job.path] = std::move(job.result);
+    }
+    if (!updated.save())
+    {
+        spdlog::error("Failed to write {}", Manifest::PATH);
+        return 1;
+    }
+    if (!pakPath.empty() && !writePackage(pakPath, root, jobs))
+    {
+        spdlog::error("Failed to write {}", pakPath);
+        return 1;
+    }
+
+    spdlog::info("{} assets: {} cooked, {} up to date, {} failed in {:.2f}s on {} threads", jobs.size(), cooked.load(),
+        jobs.size() - cooked.load() - failed.load(), failed.load(), elapsed, ThreadPool::shared().size());
+    return failed > 0 ? 1 : 0;
+}